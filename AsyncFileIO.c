@@ -0,0 +1,202 @@
+/**
+* File:   AsyncFileIO.c
+* Queued whole-file reads and writes over io_uring, or blocking calls.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "AsyncFileIO.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//MACRO DEFINITIONS
+//longest single read or write, larger files take several
+#define MAX_CHUNK (1 << 30)
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+//submit what is left of a transfer, or with no ring do all of it now
+static void start_transfer(FileIO* io, FileTransfer* transfer) {
+    size_t chunk;
+    ssize_t moved = 0;
+#ifdef GOODMAN_HAVE_LIBURING
+    struct io_uring_sqe* sqe;
+#endif
+    if(transfer->done == transfer->length){
+        transfer->state = 1;
+        return;
+    }
+#ifdef GOODMAN_HAVE_LIBURING
+    if(io->uring){
+        chunk = transfer->length - transfer->done < MAX_CHUNK ? transfer->length - transfer->done : MAX_CHUNK;
+        sqe = io_uring_get_sqe(&io->ring);
+        if(sqe != NULL){
+            if(transfer->writing)
+                io_uring_prep_write(sqe, transfer->fd, transfer->data + transfer->done, (unsigned int)chunk, transfer->done);
+            else io_uring_prep_read(sqe, transfer->fd, transfer->data + transfer->done, (unsigned int)chunk, transfer->done);
+            io_uring_sqe_set_data(sqe, transfer);
+            if(io_uring_submit(&io->ring) >= 1)
+                return;
+        }
+        transfer->state = -1;
+        return;
+    }
+#endif
+    while(transfer->done < transfer->length){
+        chunk = transfer->length - transfer->done < MAX_CHUNK ? transfer->length - transfer->done : MAX_CHUNK;
+        if(transfer->writing)
+            moved = pwrite(transfer->fd, transfer->data + transfer->done, chunk, (off_t)transfer->done);
+        else moved = pread(transfer->fd, transfer->data + transfer->done, chunk, (off_t)transfer->done);
+        if(moved < 0 && errno == EINTR)
+            continue;
+        if(moved <= 0)
+            break;
+        transfer->done += (size_t)moved;
+    }
+    //a file that shrank since it was opened is read up to its new end
+    if(!transfer->writing && transfer->done < transfer->length && moved == 0)
+        transfer->length = transfer->done;
+    transfer->state = transfer->done == transfer->length ? 1 : -1;
+}
+
+//wait until a transfer is done, handling the completions of any others that arrive first
+static void finish_transfer(FileIO* io, FileTransfer* transfer) {
+#ifdef GOODMAN_HAVE_LIBURING
+    struct io_uring_cqe* cqe;
+    FileTransfer* completed;
+    int result;
+    while(transfer->state == 0){
+        result = io_uring_wait_cqe(&io->ring, &cqe);
+        if(result == -EINTR)
+            continue;
+        if(result != 0){
+            transfer->state = -1;
+            break;
+        }
+        completed = (FileTransfer*)io_uring_cqe_get_data(cqe);
+        result = cqe->res;
+        io_uring_cqe_seen(&io->ring, cqe);
+        if(result < 0 || (result == 0 && completed->writing))
+            completed->state = -1;
+        else if(result == 0){
+            completed->length = completed->done;
+            completed->state = 1;
+        }
+        else {
+            completed->done += (size_t)result;
+            if(completed->done == completed->length)
+                completed->state = 1;
+            else start_transfer(io, completed);
+        }
+    }
+#endif
+    if(transfer->fd >= 0){
+        close(transfer->fd);
+        transfer->fd = -1;
+    }
+}
+
+//the oldest transfer, finished and removed from the queue
+static FileTransfer* pop_transfer(FileIO* io) {
+    FileTransfer* transfer = &io->transfers[io->head];
+    finish_transfer(io, transfer);
+    io->head = (io->head + 1) % io->depth;
+    io->count--;
+    if(transfer->writing && transfer->state < 0)
+        io->failures++;
+    return transfer;
+}
+
+FileIO* file_io_create(int depth) {
+    FileIO* io = (FileIO*)calloc(1, sizeof(FileIO));
+    if(io == NULL)
+        return NULL;
+    io->transfers = (FileTransfer*)calloc(depth, sizeof(FileTransfer));
+    if(io->transfers == NULL){
+        free(io);
+        return NULL;
+    }
+    io->depth = depth;
+#ifdef GOODMAN_HAVE_LIBURING
+    //kernels without io_uring, or sandboxes that forbid it, get the blocking calls
+    io->uring = io_uring_queue_init(depth, &io->ring, 0) == 0;
+#endif
+    return io;
+}
+
+void file_io_destroy(FileIO* io) {
+    if(io == NULL)
+        return;
+    while(io->count > 0)
+        free(pop_transfer(io)->data);
+#ifdef GOODMAN_HAVE_LIBURING
+    if(io->uring)
+        io_uring_queue_exit(&io->ring);
+#endif
+    free(io->transfers);
+    free(io);
+}
+
+const char* file_io_backend(const FileIO* io) {
+    return io->uring ? "io_uring" : "stdio";
+}
+
+int file_io_read(FileIO* io, const char* file_name) {
+    struct stat status;
+    FileTransfer* transfer;
+    if(io->count == io->depth)
+        return -1;
+    transfer = &io->transfers[(io->head + io->count++) % io->depth];
+    memset(transfer, 0, sizeof(FileTransfer));
+    transfer->fd = open(file_name, O_RDONLY | O_CLOEXEC);
+    //a file that cannot be opened still takes its turn, so reads come back in order
+    if(transfer->fd < 0 || fstat(transfer->fd, &status) != 0
+       || (transfer->data = (unsigned char*)malloc(status.st_size > 0 ? (size_t)status.st_size : 1)) == NULL){
+        transfer->state = -1;
+        return 0;
+    }
+    transfer->length = (size_t)status.st_size;
+    start_transfer(io, transfer);
+    return 0;
+}
+
+unsigned char* file_io_take(FileIO* io, size_t* length) {
+    FileTransfer* transfer;
+    if(io->count == 0)
+        return NULL;
+    transfer = pop_transfer(io);
+    if(transfer->state < 0){
+        free(transfer->data);
+        return NULL;
+    }
+    *length = transfer->length;
+    return transfer->data;
+}
+
+void file_io_write(FileIO* io, const char* file_name, unsigned char* data, size_t length) {
+    FileTransfer* transfer;
+    if(io->count == io->depth)
+        free(pop_transfer(io)->data);
+    transfer = &io->transfers[(io->head + io->count++) % io->depth];
+    memset(transfer, 0, sizeof(FileTransfer));
+    transfer->data = data;
+    transfer->length = length;
+    transfer->writing = 1;
+    transfer->fd = open(file_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(transfer->fd < 0)
+        transfer->state = -1;
+    else start_transfer(io, transfer);
+}
+
+int file_io_flush(FileIO* io) {
+    while(io->count > 0)
+        free(pop_transfer(io)->data);
+    return io->failures;
+}
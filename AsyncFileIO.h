@@ -0,0 +1,104 @@
+/**
+* Whole-file reads and writes kept in flight while the caller does other work,
+* through io_uring when the program is built with liburing and through plain
+* blocking calls otherwise.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef AsyncFileIO_H
+#define AsyncFileIO_H 1
+#include <stddef.h>
+#ifdef GOODMAN_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+typedef struct FileTransfer {
+	int fd;				//open file, -1 once closed
+	unsigned char* data;		//whole file contents
+	size_t length;			//bytes to move
+	size_t done;			//bytes moved so far
+	int writing;			//nonzero for a write, zero for a read
+	int state;			//0 in flight, 1 finished, -1 failed
+}FileTransfer;
+
+//Transfers are queued in a ring and finish in the order they were started, one
+//FileIO serving one thread.
+typedef struct FileIO {
+	int uring;			//nonzero when transfers go through the io_uring
+#ifdef GOODMAN_HAVE_LIBURING
+	struct io_uring ring;
+#endif
+	FileTransfer* transfers;	//ring of depth slots
+	int depth;			//most transfers in flight at once
+	int head;			//slot of the oldest transfer
+	int count;			//transfers started and not yet taken
+	int failures;			//writes that could not be completed
+}FileIO;
+
+/**
+ * set up a queue of file transfers, using io_uring if it was built in and the
+ * kernel allows it.
+ *
+ * @param  depth: Most transfers in flight at once, at least 1
+ * @return The queue, or NULL if memory ran out
+ */
+FileIO* file_io_create(int depth);
+
+
+/**
+ * wait for every transfer, then release the queue and any data not taken.
+ *
+ * @param  io: The queue to destroy, may be NULL
+ */
+void file_io_destroy(FileIO* io);
+
+
+/**
+ * name of the backend in use, "io_uring" or "stdio".
+ *
+ * @param  io: The queue
+ */
+const char* file_io_backend(const FileIO* io);
+
+
+/**
+ * start reading a whole file. Reads are taken back in the order they were started.
+ *
+ * @param  io: The queue, which must not hold depth transfers already
+ * @param  file_name: The file to read
+ * @return 0 if the read was queued, even if it will fail, -1 if the queue is full
+ */
+int file_io_read(FileIO* io, const char* file_name);
+
+
+/**
+ * wait for the oldest read and take its data.
+ *
+ * @param  io: The queue
+ * @param  length: Destination for the number of bytes read
+ * @return The file contents, to be released with free, or NULL if the read failed
+ */
+unsigned char* file_io_take(FileIO* io, size_t* length);
+
+
+/**
+ * start writing a whole file, waiting for the oldest write first if the queue is full.
+ *
+ * @param  io: The queue, used only for writes
+ * @param  file_name: The file to create or replace
+ * @param  data: Contents of the file, released with free once written
+ * @param  length: Number of bytes in data
+ */
+void file_io_write(FileIO* io, const char* file_name, unsigned char* data, size_t length);
+
+
+/**
+ * wait for every write in flight.
+ *
+ * @param  io: The queue, used only for writes
+ * @return Number of writes that have failed since the queue was created
+ */
+int file_io_flush(FileIO* io);
+#endif
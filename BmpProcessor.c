@@ -0,0 +1,207 @@
+/**
+* File:   BmpProcessor.c
+* Loading and saving of 24-bit BMP files, replacing the prebuilt object.
+* Headers are decoded from one read each and pixel data moves in blocks of
+* whole padded scanlines, with the BGR to RGB swizzle done by the vector kernels.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "BmpProcessor.h"
+#include "FilterKernels.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//MACRO DEFINITIONS
+#define BMP_HEADER_SIZE 14
+#define DIB_HEADER_SIZE 40
+//pixel data is staged through a buffer of about this many bytes of scanlines
+#define BMP_IO_BLOCK (1 << 20)
+#define BMP_RESOLUTION 3780
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+static int get_int(const unsigned char* p) {
+    return (int)((unsigned int)p[0] | (unsigned int)p[1] << 8 | (unsigned int)p[2] << 16 | (unsigned int)p[3] << 24);
+}
+
+static short get_short(const unsigned char* p) {
+    return (short)(p[0] | p[1] << 8);
+}
+
+static void put_int(unsigned char* p, int value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+static void put_short(unsigned char* p, short value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+}
+
+//bytes in one scanline of the file, which are padded to a multiple of 4
+static int padded_row_size(int width) {
+    return (width * 3 + 3) & ~3;
+}
+
+void readBMPHeader(FILE* file, struct BMP_Header* header) {
+    unsigned char buffer[BMP_HEADER_SIZE] = {0};
+    if(fread(buffer, 1, BMP_HEADER_SIZE, file) != BMP_HEADER_SIZE)
+        memset(buffer, 0, BMP_HEADER_SIZE);
+    header->signature[0] = (char)buffer[0];
+    header->signature[1] = (char)buffer[1];
+    header->size = get_int(buffer + 2);
+    header->reserved1 = get_short(buffer + 6);
+    header->reserved2 = get_short(buffer + 8);
+    header->offset_pixel_array = get_int(buffer + 10);
+}
+
+void writeBMPHeader(FILE* file, struct BMP_Header* header) {
+    unsigned char buffer[BMP_HEADER_SIZE];
+    buffer[0] = (unsigned char)header->signature[0];
+    buffer[1] = (unsigned char)header->signature[1];
+    put_int(buffer + 2, header->size);
+    put_short(buffer + 6, header->reserved1);
+    put_short(buffer + 8, header->reserved2);
+    put_int(buffer + 10, header->offset_pixel_array);
+    fwrite(buffer, 1, BMP_HEADER_SIZE, file);
+}
+
+void readDIBHeader(FILE* file, struct DIB_Header* header) {
+    unsigned char buffer[DIB_HEADER_SIZE];
+    if(fread(buffer, 1, DIB_HEADER_SIZE, file) != DIB_HEADER_SIZE)
+        memset(buffer, 0, DIB_HEADER_SIZE);
+    header->size = get_int(buffer);
+    header->width = get_int(buffer + 4);
+    header->height = get_int(buffer + 8);
+    header->planes = get_short(buffer + 12);
+    header->bitsPerPixel = get_short(buffer + 14);
+    header->compression = get_int(buffer + 16);
+    header->imageSize = get_int(buffer + 20);
+    header->horizRes = get_int(buffer + 24);
+    header->vertRes = get_int(buffer + 28);
+    header->colorNum = get_int(buffer + 32);
+    header->importantColorNum = get_int(buffer + 36);
+}
+
+void writeDIBHeader(FILE* file, struct DIB_Header* header) {
+    unsigned char buffer[DIB_HEADER_SIZE];
+    //only the 40 byte header is written, whatever version was read
+    put_int(buffer, DIB_HEADER_SIZE);
+    put_int(buffer + 4, header->width);
+    put_int(buffer + 8, header->height);
+    put_short(buffer + 12, header->planes);
+    put_short(buffer + 14, header->bitsPerPixel);
+    put_int(buffer + 16, header->compression);
+    put_int(buffer + 20, header->imageSize);
+    put_int(buffer + 24, header->horizRes);
+    put_int(buffer + 28, header->vertRes);
+    put_int(buffer + 32, header->colorNum);
+    put_int(buffer + 36, header->importantColorNum);
+    fwrite(buffer, 1, DIB_HEADER_SIZE, file);
+}
+
+void makeBMPHeader(struct BMP_Header* header, int width, int height) {
+    header->signature[0] = 'B';
+    header->signature[1] = 'M';
+    header->size = BMP_HEADER_SIZE + DIB_HEADER_SIZE + padded_row_size(width) * abs(height);
+    header->reserved1 = 0;
+    header->reserved2 = 0;
+    header->offset_pixel_array = BMP_HEADER_SIZE + DIB_HEADER_SIZE;
+}
+
+void makeDIBHeader(struct DIB_Header* header, int width, int height) {
+    header->size = DIB_HEADER_SIZE;
+    header->width = width;
+    header->height = height;
+    header->planes = 1;
+    header->bitsPerPixel = 24;
+    header->compression = 0;
+    header->imageSize = padded_row_size(width) * abs(height);
+    header->horizRes = BMP_RESOLUTION;
+    header->vertRes = BMP_RESOLUTION;
+    header->colorNum = 0;
+    header->importantColorNum = 0;
+}
+
+void readPixelsBMP(FILE* file, struct Pixel** pArr, int width, int height) {
+    int y, row, count, rows = abs(height), row_size = padded_row_size(width);
+    int block_rows = BMP_IO_BLOCK / row_size > 0 ? BMP_IO_BLOCK / row_size : 1;
+    const FilterKernels* kernels = filter_kernels();
+    unsigned char* buffer;
+    size_t got;
+    if(block_rows > rows)
+        block_rows = rows;
+    buffer = (unsigned char*)malloc((size_t)block_rows * row_size);
+    if(buffer == NULL)
+        return;
+    for(row = 0; row < rows; row += count){
+        count = rows - row < block_rows ? rows - row : block_rows;
+        got = fread(buffer, 1, (size_t)count * row_size, file);
+        //a truncated file leaves the missing scanlines black
+        if(got < (size_t)count * row_size)
+            memset(buffer + got, 0, (size_t)count * row_size - got);
+        //scanlines are stored bottom-up unless the height is negative
+        for(y = 0; y < count; y++)
+            kernels->swap_red_blue((unsigned char*)pArr[height > 0 ? rows - 1 - row - y : row + y], buffer + (size_t)y * row_size, width);
+    }
+    free(buffer);
+}
+
+int writePixelRowsBMP(int fd, long offset, struct Pixel** pArr, int width, int height, int start, int end) {
+    int y, row, count, rows = abs(height), row_size = padded_row_size(width);
+    int block_rows = BMP_IO_BLOCK / row_size > 0 ? BMP_IO_BLOCK / row_size : 1;
+    const FilterKernels* kernels = filter_kernels();
+    unsigned char* buffer;
+    size_t length, done;
+    ssize_t written;
+    if(block_rows > end - start)
+        block_rows = end - start > 0 ? end - start : 1;
+    buffer = (unsigned char*)calloc((size_t)block_rows, row_size);
+    if(buffer == NULL)
+        return -1;
+    for(row = start; row < end; row += count){
+        count = end - row < block_rows ? end - row : block_rows;
+        for(y = 0; y < count; y++)
+            kernels->swap_red_blue(buffer + (size_t)y * row_size, (const unsigned char*)pArr[height > 0 ? rows - 1 - row - y : row + y], width);
+        length = (size_t)count * row_size;
+        for(done = 0; done < length; done += (size_t)written){
+            written = pwrite(fd, buffer + done, length - done, (off_t)offset + (off_t)row * row_size + (off_t)done);
+            if(written < 0 && errno == EINTR)
+                written = 0;
+            else if(written <= 0){
+                free(buffer);
+                return -1;
+            }
+        }
+    }
+    free(buffer);
+    return 0;
+}
+
+void writePixelsBMP(FILE* file, struct Pixel** pArr, int width, int height) {
+    int y, row, count, rows = abs(height), row_size = padded_row_size(width);
+    int block_rows = BMP_IO_BLOCK / row_size > 0 ? BMP_IO_BLOCK / row_size : 1;
+    const FilterKernels* kernels = filter_kernels();
+    unsigned char* buffer;
+    if(block_rows > rows)
+        block_rows = rows;
+    //zeroed once so the padding at the end of every scanline stays zero
+    buffer = (unsigned char*)calloc((size_t)block_rows, row_size);
+    if(buffer == NULL)
+        return;
+    for(row = 0; row < rows; row += count){
+        count = rows - row < block_rows ? rows - row : block_rows;
+        for(y = 0; y < count; y++)
+            kernels->swap_red_blue(buffer + (size_t)y * row_size, (const unsigned char*)pArr[height > 0 ? rows - 1 - row - y : row + y], width);
+        fwrite(buffer, 1, (size_t)count * row_size, file);
+    }
+    free(buffer);
+}
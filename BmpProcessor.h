@@ -8,8 +8,11 @@
 * (typedefs added by Goodman)
 */
 
+#ifndef BmpProcessor_H
+#define BmpProcessor_H 1
 #include <stdio.h>
 #include "PixelProcessor.h"
+#include "FilterExport.h"
 
 typedef struct BMP_Header {
 	char signature[2];		//ID field
@@ -39,7 +42,7 @@ typedef struct DIB_Header{
  * @param  file: A pointer to the file being read
  * @param  header: Pointer to the destination BMP header
  */
-void readBMPHeader(FILE* file, struct BMP_Header* header);
+GOODMAN_API void readBMPHeader(FILE* file, struct BMP_Header* header);
 
 
 /**
@@ -48,7 +51,7 @@ void readBMPHeader(FILE* file, struct BMP_Header* header);
  * @param  file: A pointer to the file being written
  * @param  header: The header to write to the file
  */
-void writeBMPHeader(FILE* file, struct BMP_Header* header);
+GOODMAN_API void writeBMPHeader(FILE* file, struct BMP_Header* header);
 
 
 /**
@@ -57,7 +60,7 @@ void writeBMPHeader(FILE* file, struct BMP_Header* header);
  * @param  file: A pointer to the file being read
  * @param  header: Pointer to the destination DIB header
  */
-void readDIBHeader(FILE* file, struct DIB_Header* header);
+GOODMAN_API void readDIBHeader(FILE* file, struct DIB_Header* header);
 
 
 /**
@@ -66,7 +69,7 @@ void readDIBHeader(FILE* file, struct DIB_Header* header);
  * @param  file: A pointer to the file being written
  * @param  header: The header to write to the file
  */
-void writeDIBHeader(FILE* file, struct DIB_Header* header);
+GOODMAN_API void writeDIBHeader(FILE* file, struct DIB_Header* header);
 
 
 /**
@@ -78,7 +81,7 @@ void writeDIBHeader(FILE* file, struct DIB_Header* header);
  * @param  width: Width of the image that this header is for
  * @param  height: Height of the image that this header is for
  */
-void makeBMPHeader(struct BMP_Header* header, int width, int height);
+GOODMAN_API void makeBMPHeader(struct BMP_Header* header, int width, int height);
 
 
  /**
@@ -89,7 +92,7 @@ void makeBMPHeader(struct BMP_Header* header, int width, int height);
  * @param  width: Width of the image that this header is for
  * @param  height: Height of the image that this header is for
  */
-void makeDIBHeader(struct DIB_Header* header, int width, int height);
+GOODMAN_API void makeDIBHeader(struct DIB_Header* header, int width, int height);
 
 
 /**
@@ -100,7 +103,7 @@ void makeDIBHeader(struct DIB_Header* header, int width, int height);
  * @param  width: Width of the pixel array of this image
  * @param  height: Height of the pixel array of this image
  */
-void readPixelsBMP(FILE* file, struct Pixel** pArr, int width, int height);
+GOODMAN_API void readPixelsBMP(FILE* file, struct Pixel** pArr, int width, int height);
 
 
 /**
@@ -111,4 +114,21 @@ void readPixelsBMP(FILE* file, struct Pixel** pArr, int width, int height);
  * @param  width: Width of the pixel array of this image
  * @param  height: Height of the pixel array of this image
  */
-void writePixelsBMP(FILE* file, struct Pixel** pArr, int width, int height);
\ No newline at end of file
+GOODMAN_API void writePixelsBMP(FILE* file, struct Pixel** pArr, int width, int height);
+
+
+/**
+ * write some of the scanlines of a BMP pixel array with positional writes, so
+ * that several threads can fill in different scanlines of the same file at once.
+ *
+ * @param  fd: Descriptor of the file being written
+ * @param  offset: Position of the pixel array in the file
+ * @param  pArr: Pixel array of the image to write to the file
+ * @param  width: Width of the pixel array of this image
+ * @param  height: Height of the pixel array of this image, negative if stored top-down
+ * @param  start: First scanline to write, counted in file order
+ * @param  end: One past the last scanline to write
+ * @return 0 on success, -1 if memory ran out or a write failed
+ */
+int writePixelRowsBMP(int fd, long offset, struct Pixel** pArr, int width, int height, int start, int end);
+#endif
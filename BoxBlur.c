@@ -0,0 +1,193 @@
+/**
+* File:   BoxBlur.c
+* Separable sliding-window box blur of arbitrary radius.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "BoxBlur.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//MACRO DEFINITIONS
+//averages over fewer pixels than this use a 48-bit fixed-point reciprocal, which
+//is exact while 255 * count * count < 2^48; larger boxes fall back to division
+#define RECIP_LIMIT (1 << 20)
+#define RECIP_SHIFT 48
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+//running sum along one row: sums[3x + c] = channel c summed over columns x - radius to x + radius
+static void sum_row(const Pixel* row, unsigned int* sums, int width, int radius) {
+    const unsigned char* p = (const unsigned char*)row;
+    unsigned int red = 0, green = 0, blue = 0;
+    int x, limit = radius < width - 1 ? radius : width - 1;
+    for(x = 0; x <= limit; x++){
+        red += p[3 * x];
+        green += p[3 * x + 1];
+        blue += p[3 * x + 2];
+    }
+    for(x = 0; x < width; x++){
+        sums[3 * x] = red;
+        sums[3 * x + 1] = green;
+        sums[3 * x + 2] = blue;
+        //slide the window one column to the right
+        if(x + radius + 1 < width){
+            red += p[3 * (x + radius + 1)];
+            green += p[3 * (x + radius + 1) + 1];
+            blue += p[3 * (x + radius + 1) + 2];
+        }
+        if(x - radius >= 0){
+            red -= p[3 * (x - radius)];
+            green -= p[3 * (x - radius) + 1];
+            blue -= p[3 * (x - radius) + 2];
+        }
+    }
+}
+
+//window totals are 32 bits, or 64 bits in wide_total for boxes that could pass 2^32
+static void add_sums(unsigned int* total, unsigned long long* wide_total, const unsigned int* sums, int n) {
+    int k;
+    if(wide_total != NULL)
+        for(k = 0; k < n; k++)
+            wide_total[k] += sums[k];
+    else
+        for(k = 0; k < n; k++)
+            total[k] += sums[k];
+}
+
+static void subtract_sums(unsigned int* total, unsigned long long* wide_total, const unsigned int* sums, int n) {
+    int k;
+    if(wide_total != NULL)
+        for(k = 0; k < n; k++)
+            wide_total[k] -= sums[k];
+    else
+        for(k = 0; k < n; k++)
+            total[k] -= sums[k];
+}
+
+//divide channel sums k0 to k1 - 1, which all cover count pixels, into output bytes
+static void box_average_span(const unsigned int* sums, const unsigned long long* wide_sums, unsigned char* out,
+                             int k0, int k1, unsigned long long count) {
+    int k;
+    unsigned long long recip;
+    if(count < RECIP_LIMIT){
+        //totals of fewer pixels than the limit are under 2^28, even when kept wide
+        recip = ((1ULL << RECIP_SHIFT) + count - 1) / count;
+        if(wide_sums != NULL)
+            for(k = k0; k < k1; k++)
+                out[k] = (unsigned char)(((unsigned int)wide_sums[k] * recip) >> RECIP_SHIFT);
+        else
+            for(k = k0; k < k1; k++)
+                out[k] = (unsigned char)((sums[k] * recip) >> RECIP_SHIFT);
+    }
+    else if(wide_sums != NULL)
+        for(k = k0; k < k1; k++)
+            out[k] = (unsigned char)(wide_sums[k] / count);
+    else
+        for(k = k0; k < k1; k++)
+            out[k] = (unsigned char)(sums[k] / count);
+}
+
+static void average_row(const unsigned int* sums, const unsigned long long* wide_sums, Pixel* out, int width, int radius,
+                        int rows_in_window) {
+    unsigned char* o = (unsigned char*)out;
+    int x, left, right;
+    //columns whose window is clipped by the left or right border
+    int first = radius < width ? radius : width;
+    int last = width - radius > first ? width - radius : first;
+    for(x = 0; x < first; x++){
+        right = x + radius < width ? x + radius : width - 1;
+        box_average_span(sums, wide_sums, o, 3 * x, 3 * x + 3, (unsigned long long)(right + 1) * rows_in_window);
+    }
+    box_average_span(sums, wide_sums, o, 3 * first, 3 * last, (2ULL * radius + 1) * rows_in_window);
+    for(x = last; x < width; x++){
+        left = x - radius > 0 ? x - radius : 0;
+        right = x + radius < width ? x + radius : width - 1;
+        box_average_span(sums, wide_sums, o, 3 * x, 3 * x + 3, (unsigned long long)(right - left + 1) * rows_in_window);
+    }
+}
+
+void box_average_row(const unsigned int* sums, Pixel* out, int width, int radius, int rows_in_window) {
+    average_row(sums, NULL, out, width, radius, rows_in_window);
+}
+
+void box_average_row_wide(const unsigned long long* sums, Pixel* out, int width, int radius, int rows_in_window) {
+    average_row(NULL, sums, out, width, radius, rows_in_window);
+}
+
+int box_blur_rows(const Image* input, Image* output, int radius, int start, int end) {
+    return box_blur_window(input, 0, input->height, output, 0, radius, start, end);
+}
+
+int box_blur_window(const Image* window, int window_top, int height, Image* output, int output_top, int radius, int start, int end) {
+    int y, top, bottom, ring_rows, box_columns, width = window->width, n = 3 * window->width;
+    unsigned int *sums = NULL, *ring, *row_sums;
+    unsigned long long* wide_sums = NULL;
+    //a box past both sides of the image covers all of it, and so does any larger one
+    if(radius > width && radius > height)
+        radius = width > height ? width : height;
+    //the row sums of every row in the vertical window, row y in slot y % ring_rows
+    ring_rows = radius < height / 2 ? 2 * radius + 1 : height;
+    ring = (unsigned int*)malloc((size_t)(ring_rows > 0 ? ring_rows : 1) * n * sizeof(unsigned int));
+    //a row's sums always fit 32 bits, the window's totals only while 255 times the box does
+    box_columns = radius < width / 2 ? 2 * radius + 1 : width;
+    if(255ULL * box_columns * ring_rows > UINT_MAX)
+        wide_sums = (unsigned long long*)calloc(n, sizeof(unsigned long long));
+    else sums = (unsigned int*)calloc(n, sizeof(unsigned int));
+    if((sums == NULL && wide_sums == NULL) || ring == NULL){
+        free(sums);
+        free(wide_sums);
+        free(ring);
+        return -1;
+    }
+    if(start < end){
+        //prime the vertical window with the rows that reach the first row of the band
+        top = start - radius > 0 ? start - radius : 0;
+        bottom = start + radius < height - 1 ? start + radius : height - 1;
+        for(y = top; y <= bottom; y++){
+            row_sums = ring + (size_t)(y % ring_rows) * n;
+            sum_row(image_row(window, y - window_top), row_sums, width, radius);
+            add_sums(sums, wide_sums, row_sums, n);
+        }
+    }
+    for(y = start; y < end; y++){
+        top = y - radius > 0 ? y - radius : 0;
+        bottom = y + radius < height - 1 ? y + radius : height - 1;
+        average_row(sums, wide_sums, image_row(output, y - output_top), width, radius, bottom - top + 1);
+        //slide the window one row down, unless the band is done and the rows below may not be held
+        if(y + 1 == end)
+            break;
+        //the leaving row's sums are still in the ring, in the slot the entering row takes over
+        if(y - radius >= 0)
+            subtract_sums(sums, wide_sums, ring + (size_t)((y - radius) % ring_rows) * n, n);
+        if(y + radius + 1 < height){
+            row_sums = ring + (size_t)((y + radius + 1) % ring_rows) * n;
+            sum_row(image_row(window, y + radius + 1 - window_top), row_sums, width, radius);
+            add_sums(sums, wide_sums, row_sums, n);
+        }
+    }
+    free(sums);
+    free(wide_sums);
+    free(ring);
+    return 0;
+}
+
+void gaussian_box_radii(double sigma, int passes, int* radii) {
+    int i, lower, upper, lower_count;
+    //widest odd box that n passes of keep under the Gaussian's variance
+    double ideal = sqrt(12.0 * sigma * sigma / passes + 1.0);
+    lower = (int)floor(ideal);
+    if(lower % 2 == 0)
+        lower--;
+    upper = lower + 2;
+    //mix lower and upper sized boxes so the total variance matches sigma squared
+    lower_count = (int)lround((12.0 * sigma * sigma - passes * lower * lower - 4.0 * passes * lower - 3.0 * passes) / (-4.0 * lower - 4.0));
+    for(i = 0; i < passes; i++)
+        radii[i] = ((i < lower_count ? lower : upper) - 1) / 2;
+}
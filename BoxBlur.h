@@ -0,0 +1,79 @@
+/**
+* Box blur of any radius in constant time per pixel, using separable running sums.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef BoxBlur_H
+#define BoxBlur_H 1
+#include "ImageBuffer.h"
+
+/**
+ * blur a band of rows with a (2 * radius + 1) square box. Like blur_filter, each
+ * output pixel is the average of only the neighbours that lie inside the image.
+ * A horizontal running sum is taken once along every row that reaches the band
+ * and kept in a ring of 2 * radius + 1 rows, and a vertical running sum of those
+ * is slid down the band, so the cost per pixel does not depend on the radius.
+ * The vertical sums are 64 bits when a box can hold more than 2^32 / 255 pixels.
+ * Bands of the same image can be blurred concurrently.
+ *
+ * @param  input: Image to read, which must not be the output image
+ * @param  output: Image to write, the same size as the input
+ * @param  radius: Number of neighbours on each side of a pixel, 0 copies the band
+ * @param  start: First row of the band
+ * @param  end: One past the last row of the band
+ * @return 0 on success, -1 if scratch memory could not be allocated
+ */
+int box_blur_rows(const Image* input, Image* output, int radius, int start, int end);
+
+
+/**
+ * blur a band of rows of an image of which only some rows are held in memory,
+ * for streaming an image through a window of scanlines. Row y of the image is
+ * row y - window_top of the window and is written to row y - output_top of the
+ * output. The window must hold every row within radius of the band.
+ *
+ * @param  window: The rows of the input image that are in memory
+ * @param  window_top: Image row held in the first row of the window
+ * @param  height: Height of the whole image
+ * @param  output: Rows to write the band into
+ * @param  output_top: Image row held in the first row of the output
+ * @param  radius: Number of neighbours on each side of a pixel, 0 copies the band
+ * @param  start: First image row of the band
+ * @param  end: One past the last image row of the band
+ * @return 0 on success, -1 if scratch memory could not be allocated
+ */
+int box_blur_window(const Image* window, int window_top, int height, Image* output, int output_top, int radius, int start, int end);
+
+
+/**
+ * divide one row of box sums into output pixels. Column x of the sums must hold
+ * the channel totals of the in-bounds part of the box around it, which spans
+ * rows_in_window rows.
+ *
+ * @param  sums: 3 * width channel totals, red, green and blue for each column
+ * @param  out: Output row to write
+ * @param  width: Width of the image in pixels
+ * @param  radius: Number of neighbours on each side of a pixel, at least 1
+ * @param  rows_in_window: Number of in-bounds rows the box covers
+ */
+void box_average_row(const unsigned int* sums, Pixel* out, int width, int radius, int rows_in_window);
+
+
+/**
+ * box_average_row for 64-bit sums, from boxes holding more than 2^32 / 255 pixels.
+ */
+void box_average_row_wide(const unsigned long long* sums, Pixel* out, int width, int radius, int rows_in_window);
+
+
+/**
+ * radii of successive box blurs whose combination approximates a Gaussian blur,
+ * following the box sizes of P. Kovesi, "Fast Almost-Gaussian Filtering".
+ *
+ * @param  sigma: Standard deviation of the Gaussian, in pixels
+ * @param  passes: Number of box blurs, 3 is usually close enough
+ * @param  radii: Destination for one radius per pass, smallest first
+ */
+void gaussian_box_radii(double sigma, int passes, int* radii);
+#endif
@@ -0,0 +1,95 @@
+/**
+* File:   BoxBlurCheck.c
+* Checks the box blur and the summed-area blur at radii whose boxes hold more
+* than 2^32 / 255 pixels, where 32-bit totals would wrap: a constant image must
+* blur to itself.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "ImageBuffer.h"
+#include "BoxBlur.h"
+#include "SummedAreaTable.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//MACRO DEFINITIONS
+//4200 x 4200 x 255 is past 2^32, so a box over most of the image overflows 32 bits
+#define CHECK_SIDE 4200
+
+////////////////////////////////////////////////////////////////////////////////
+//GLOBAL VARIABLES
+//radii from one that first needs wide totals up to one far past the image
+static const int radii[] = {2048, 2100, 5000, INT_MAX};
+static const Pixel color = {250, 128, 7};
+
+////////////////////////////////////////////////////////////////////////////////
+//FORWARD DECLARATIONS
+int check_constant(const Image* output, const char* filter, int radius);
+
+////////////////////////////////////////////////////////////////////////////////
+//MAIN PROGRAM CODE
+int main(void){
+    int i, x, y, failed = 0;
+    Image* input = image_create(CHECK_SIDE, CHECK_SIDE);
+    Image* output = image_create(CHECK_SIDE, CHECK_SIDE);
+    SummedAreaTable* table = sat_create(CHECK_SIDE, CHECK_SIDE);
+    if(input == NULL || output == NULL || table == NULL){
+        printf("Not enough memory for a %dx%d image. Exiting.\n", CHECK_SIDE, CHECK_SIDE);
+        return 1;
+    }
+    for(y = 0; y < CHECK_SIDE; y++)
+        for(x = 0; x < CHECK_SIDE; x++)
+            image_row(input, y)[x] = color;
+    sat_scan_rows(table, input, 0, CHECK_SIDE);
+    sat_scan_columns(table, 0, CHECK_SIDE);
+    for(i = 0; i < (int)(sizeof(radii) / sizeof(radii[0])); i++){
+        memset(output->data, 0, (size_t)output->stride * output->height);
+        if(box_blur_rows(input, output, radii[i], 0, CHECK_SIDE) != 0){
+            printf("Not enough memory to blur. Exiting.\n");
+            return 1;
+        }
+        failed += check_constant(output, "box_blur_rows", radii[i]);
+        memset(output->data, 0, (size_t)output->stride * output->height);
+        if(sat_blur_rows(table, output, radii[i], 0, CHECK_SIDE) != 0){
+            printf("Not enough memory to blur. Exiting.\n");
+            return 1;
+        }
+        failed += check_constant(output, "sat_blur_rows", radii[i]);
+    }
+    sat_destroy(table);
+    image_destroy(input);
+    image_destroy(output);
+    printf("%s\n", failed == 0 ? "Large boxes keep a constant image constant" : "Large boxes changed a constant image");
+    return failed == 0 ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+/**
+ * compare every pixel of a blurred constant image with the constant.
+ *
+ * @param  output: The blurred image
+ * @param  filter: Name of the blur, for the report
+ * @param  radius: Radius it blurred at
+ * @return 0 if every pixel matches, 1 if not
+ */
+int check_constant(const Image* output, const char* filter, int radius){
+    int x, y;
+    const Pixel* pixel;
+    for(y = 0; y < output->height; y++)
+        for(x = 0; x < output->width; x++){
+            pixel = &image_row(output, y)[x];
+            if(pixel->red != color.red || pixel->green != color.green || pixel->blue != color.blue){
+                printf("%s at radius %d gives (%d, %d, %d) at (%d, %d) for (%d, %d, %d).\n", filter, radius,
+                       pixel->red, pixel->green, pixel->blue, x, y, color.red, color.green, color.blue);
+                return 1;
+            }
+        }
+    return 0;
+}
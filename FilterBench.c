@@ -0,0 +1,306 @@
+/**
+* File:   FilterBench.c
+* Times the filters, the cheese holes and BMP encoding on synthetic images at
+* several thread counts, and reports the results as JSON.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "BmpProcessor.h"
+#include "ImageBuffer.h"
+#include "FilterContext.h"
+#include "FilterJobs.h"
+#include "FilterKernels.h"
+#include "HoleMask.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//MACRO DEFINITIONS
+#define DEFAULT_REPEATS 5
+#define MAX_THREAD_COUNTS 16
+//the bench always cuts the same holes, so runs compare like with like
+#define BENCH_SEED 1
+
+////////////////////////////////////////////////////////////////////////////////
+//DATA STRUCTURES
+//one synthetic input image
+typedef struct BenchCase {
+    int width;
+    int height;
+    const char* pattern;    //noise or gradient
+}BenchCase;
+
+//what every timed stage of a case works on
+typedef struct BenchRun {
+    FilterContext* filters; //the stages go through the same calls as the program
+    FilterSettings settings;
+    Image* input;
+    Image* output;
+    unsigned char* file;    //the pixel array of a BMP file of the image
+    size_t length;
+    FILE* scratch;          //temporary file the parallel encoder writes to
+}BenchRun;
+
+typedef struct BenchStage {
+    const char* name;
+    void (*run)(BenchRun* run);
+    int parallel;           //0 if the stage runs on one thread whatever the pool size
+}BenchStage;
+
+////////////////////////////////////////////////////////////////////////////////
+//FORWARD DECLARATIONS
+void fill_image(Image* image, const char* pattern);
+double now(void);
+int compare_times(const void* a, const void* b);
+void blur_stage(BenchRun* run);
+void box_blur_stage(BenchRun* run);
+void gaussian_stage(BenchRun* run);
+void cheese_stage(BenchRun* run);
+void holes_stage(BenchRun* run);
+void apply_stage(BenchRun* run);
+void bmp_write_stage(BenchRun* run);
+void bmp_read_stage(BenchRun* run);
+FILE* open_file_memory(BenchRun* run, const char* mode);
+
+////////////////////////////////////////////////////////////////////////////////
+//GLOBAL VARIABLES
+//square, non-square and odd-width images from 256x256 up to 16384x16384
+static const BenchCase cases[] = {
+    {256, 256, "noise"},
+    {256, 256, "gradient"},
+    {1023, 767, "noise"},
+    {1920, 1080, "gradient"},
+    {2048, 2048, "noise"},
+    {4097, 3001, "noise"},
+    {8192, 8192, "gradient"},
+    {16384, 16384, "noise"},
+};
+
+static const BenchStage stages[] = {
+    {"blur", blur_stage, 1},
+    {"box_blur_r8", box_blur_stage, 1},
+    {"gaussian", gaussian_stage, 1},
+    {"cheese", cheese_stage, 1},
+    {"holes", holes_stage, 1},
+    {"bmp_write", bmp_write_stage, 1},
+    {"bmp_read", bmp_read_stage, 0},
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//MAIN PROGRAM CODE
+int main(int argc, char* argv[]){
+    int i, j, k, r, opt, repeats = DEFAULT_REPEATS, max_side = 16384, first = 1;
+    int threads[MAX_THREAD_COUNTS], thread_count = 0, cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    double *times, start, median, p95, pixels;
+    char* token;
+    FILE* file;
+    BenchRun run;
+    while((opt = getopt(argc, argv, "n:t:x:")) != -1)
+        switch(opt){
+            case 'n':
+                repeats = atoi(optarg);
+                if(repeats < 1){
+                    fprintf(stderr, "Invalid repeat count argument. Exiting\n");
+                    exit(1);
+                }
+                break;
+            case 't':
+                //comma separated thread counts
+                for(token = strtok(optarg, ","); token != NULL; token = strtok(NULL, ",")){
+                    if(thread_count == MAX_THREAD_COUNTS || (threads[thread_count++] = atoi(token)) < 1){
+                        fprintf(stderr, "Invalid thread count argument. Exiting\n");
+                        exit(1);
+                    }
+                }
+                break;
+            case 'x':
+                //skip images wider or taller than this
+                max_side = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n repeats] [-t threads,...] [-x max side]\n", argv[0]);
+                exit(1);
+        }
+    //default to 1, 2, 4, ... workers and then one per online cpu
+    if(thread_count == 0){
+        for(i = 1; i < cpus && thread_count < MAX_THREAD_COUNTS - 1; i *= 2)
+            threads[thread_count++] = i;
+        threads[thread_count++] = cpus > 0 ? cpus : 1;
+    }
+    times = (double*)malloc(repeats * sizeof(double));
+    if(times == NULL){
+        fprintf(stderr, "Not enough memory. Exiting.\n");
+        exit(1);
+    }
+    printf("{\n  \"isa\": \"%s\",\n  \"cpus\": %d,\n  \"repeats\": %d,\n  \"results\": [", filter_kernels()->isa, cpus, repeats);
+    for(i = 0; i < (int)(sizeof(cases) / sizeof(cases[0])); i++){
+        if(cases[i].width > max_side || cases[i].height > max_side)
+            continue;
+        memset(&run, 0, sizeof(run));
+        run.length = (size_t)((cases[i].width * 3 + 3) & ~3) * cases[i].height;
+        run.input = image_create(cases[i].width, cases[i].height);
+        run.output = image_create(cases[i].width, cases[i].height);
+        run.file = (unsigned char*)malloc(run.length);
+        run.scratch = tmpfile();
+        if(run.input == NULL || run.output == NULL || run.file == NULL || run.scratch == NULL){
+            fprintf(stderr, "Not enough memory for a %dx%d image. Skipped.\n", cases[i].width, cases[i].height);
+            image_destroy(run.input);
+            image_destroy(run.output);
+            free(run.file);
+            if(run.scratch != NULL)
+                fclose(run.scratch);
+            continue;
+        }
+        fill_image(run.input, cases[i].pattern);
+        //the pixel array bmp_read decodes, encoded once up front
+        file = open_file_memory(&run, "wb");
+        writePixelsBMP(file, run.input->rows, run.input->width, run.input->height);
+        fclose(file);
+        pixels = (double)cases[i].width * cases[i].height;
+        for(j = 0; j < (int)(sizeof(stages) / sizeof(stages[0])); j++)
+            for(k = 0; k < (stages[j].parallel ? thread_count : 1); k++){
+                run.filters = filter_context_create(stages[j].parallel ? threads[k] : 1);
+                if(run.filters == NULL){
+                    fprintf(stderr, "Could not start worker threads. Exiting.\n");
+                    exit(1);
+                }
+                run.settings.radius = 1;
+                run.settings.sigma = 2.0;
+                run.settings.tint[0] = 50;
+                run.settings.tint[1] = 50;
+                run.settings.tint[2] = 0;
+                run.settings.seed = BENCH_SEED;
+                //the hole layout has no context call of its own, so it runs on the context's workers
+                run.settings.pool = run.filters->pool;
+                fprintf(stderr, "%dx%d %s: %s on %d threads\n", cases[i].width, cases[i].height, cases[i].pattern, stages[j].name, run.filters->pool->size);
+                //one untimed run to fault in the pages and warm the caches
+                stages[j].run(&run);
+                for(r = 0; r < repeats; r++){
+                    start = now();
+                    stages[j].run(&run);
+                    times[r] = now() - start;
+                }
+                qsort(times, repeats, sizeof(double), compare_times);
+                median = repeats % 2 == 1 ? times[repeats / 2] : (times[repeats / 2 - 1] + times[repeats / 2]) / 2;
+                //nearest rank
+                p95 = times[(repeats * 95 + 99) / 100 - 1];
+                printf("%s\n    {\"image\": \"%s\", \"width\": %d, \"height\": %d, \"stage\": \"%s\", \"threads\": %d, "
+                       "\"median_ms\": %.3f, \"p95_ms\": %.3f, \"mpix_per_s\": %.1f}",
+                       first ? "" : ",", cases[i].pattern, cases[i].width, cases[i].height, stages[j].name,
+                       run.filters->pool->size, median * 1e3, p95 * 1e3, pixels / median / 1e6);
+                fflush(stdout);
+                first = 0;
+                filter_context_destroy(run.filters);
+            }
+        image_destroy(run.input);
+        image_destroy(run.output);
+        free(run.file);
+        fclose(run.scratch);
+    }
+    printf("\n  ]\n}\n");
+    free(times);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+void fill_image(Image* image, const char* pattern){
+    int x, y;
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    Pixel* row;
+    for(y = 0; y < image->height; y++){
+        row = image_row(image, y);
+        for(x = 0; x < image->width; x++){
+            if(strcmp(pattern, "noise") == 0){
+                //xorshift64, plenty random for blurring
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                row[x].red = (unsigned char)state;
+                row[x].green = (unsigned char)(state >> 8);
+                row[x].blue = (unsigned char)(state >> 16);
+            }
+            else {
+                row[x].red = (unsigned char)(255L * x / (image->width > 1 ? image->width - 1 : 1));
+                row[x].green = (unsigned char)(255L * y / (image->height > 1 ? image->height - 1 : 1));
+                row[x].blue = (unsigned char)(x + y);
+            }
+        }
+    }
+}
+
+double now(void){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+int compare_times(const void* a, const void* b){
+    double difference = *(const double*)a - *(const double*)b;
+    return (difference > 0) - (difference < 0);
+}
+
+void blur_stage(BenchRun* run){
+    run->settings.filter_type = 'b';
+    run->settings.radius = 1;
+    apply_stage(run);
+}
+
+void box_blur_stage(BenchRun* run){
+    run->settings.filter_type = 'b';
+    run->settings.radius = 8;
+    apply_stage(run);
+}
+
+void gaussian_stage(BenchRun* run){
+    run->settings.filter_type = 'g';
+    apply_stage(run);
+}
+
+void cheese_stage(BenchRun* run){
+    run->settings.filter_type = 'c';
+    apply_stage(run);
+}
+
+void holes_stage(BenchRun* run){
+    hole_mask_destroy(cheese_holes(&run->settings, run->input));
+}
+
+void apply_stage(BenchRun* run){
+    if(filter_context_apply(run->filters, &run->settings, run->input, run->output) != 0){
+        fprintf(stderr, "Not enough memory to finish filtering. Exiting.\n");
+        exit(1);
+    }
+}
+
+void bmp_write_stage(BenchRun* run){
+    //bands of scanlines encoded and written on the workers, as the program writes its
+    //output, into the page cache of a temporary file, which the disk does not hold up
+    rewind(run->scratch);
+    if(filter_context_write_pixels(run->filters, &run->settings, run->scratch, run->input, run->input->height) != 0){
+        fprintf(stderr, "Could not write the encoded image. Exiting.\n");
+        exit(1);
+    }
+}
+
+void bmp_read_stage(BenchRun* run){
+    FILE* file = open_file_memory(run, "rb");
+    readPixelsBMP(file, run->output->rows, run->output->width, run->output->height);
+    fclose(file);
+}
+
+FILE* open_file_memory(BenchRun* run, const char* mode){
+    //the pixel array in memory, so the disk does not set the pace
+    FILE* file = fmemopen(run->file, run->length, mode);
+    if(file == NULL){
+        fprintf(stderr, "Could not open the image in memory. Exiting.\n");
+        exit(1);
+    }
+    return file;
+}
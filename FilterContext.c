@@ -0,0 +1,184 @@
+/**
+* File:   FilterContext.c
+* Contexts that filter images on their own worker threads.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include "FilterContext.h"
+#include "BmpProcessor.h"
+#include "StreamBlur.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//DATA STRUCTURES
+//what the tasks writing one pixel array share: task i writes band i of count
+//bands of scanlines, in file order
+typedef struct WriteJob {
+    Image* image;
+    int fd;
+    long offset;        //where the pixel array starts in the file
+    int height;         //height from the DIB header, negative for a top-down file
+    int count;
+    atomic_int failed;  //set by a task whose write failed
+}WriteJob;
+
+////////////////////////////////////////////////////////////////////////////////
+//FORWARD DECLARATIONS
+void write_task(void* context, int task, int worker);
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+FilterContext* filter_context_create(int threads) {
+    FilterContext* context = (FilterContext*)malloc(sizeof(FilterContext));
+    if(context == NULL)
+        return NULL;
+    if(threads < 1)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    context->pool = pool_create(threads > 0 ? threads : 1);
+    if(context->pool == NULL){
+        free(context);
+        return NULL;
+    }
+    pthread_mutex_init(&context->lock, NULL);
+    return context;
+}
+
+void filter_context_destroy(FilterContext* context) {
+    if(context == NULL)
+        return;
+    pool_destroy(context->pool);
+    pthread_mutex_destroy(&context->lock);
+    free(context);
+}
+
+int filter_context_apply(FilterContext* context, const FilterSettings* settings, Image* input, Image* output) {
+    int result;
+    FilterSettings own = *settings;
+    if(input == NULL || output == NULL || input == output || input->data == output->data
+       || input->width != output->width || input->height != output->height
+       || (own.filter_type != 'b' && own.filter_type != 'g' && own.filter_type != 'c')
+       || (own.filter_type == 'b' && own.radius < 1) || (own.filter_type == 'g' && !(own.sigma > 0))){
+        errno = EINVAL;
+        return -1;
+    }
+    own.pool = context->pool;
+    pthread_mutex_lock(&context->lock);
+    result = apply_filter(&own, input, output);
+    pthread_mutex_unlock(&context->lock);
+    if(result != 0)
+        errno = ENOMEM;
+    return result;
+}
+
+int filter_context_apply_radii(FilterContext* context, const FilterSettings* settings, Image* input,
+                               const int* radii, int count, RadiusSink* sink) {
+    int i, result = 0;
+    Image* output;
+    SummedAreaTable* table;
+    FilterSettings own = *settings;
+    if(input == NULL || radii == NULL || count < 1 || sink == NULL){
+        errno = EINVAL;
+        return -1;
+    }
+    for(i = 0; i < count; i++)
+        if(radii[i] < 1){
+            errno = EINVAL;
+            return -1;
+        }
+    own.pool = context->pool;
+    pthread_mutex_lock(&context->lock);
+    table = blur_table(&own, input);
+    pthread_mutex_unlock(&context->lock);
+    if(table == NULL){
+        errno = ENOMEM;
+        return -1;
+    }
+    //the lock is let go between radii, so the sink can write each one on the same workers
+    for(i = 0; i < count && result == 0; i++){
+        output = sink->open(sink->context, radii[i]);
+        if(output == NULL || output->width != input->width || output->height != input->height){
+            errno = output == NULL ? ECANCELED : EINVAL;
+            result = -1;
+            break;
+        }
+        pthread_mutex_lock(&context->lock);
+        result = blur_from_table(&own, table, radii[i], output);
+        pthread_mutex_unlock(&context->lock);
+        if(result != 0)
+            errno = ENOMEM;
+        else if(sink->close(sink->context, radii[i], output) != 0){
+            errno = ECANCELED;
+            result = -1;
+        }
+    }
+    sat_destroy(table);
+    return result;
+}
+
+int filter_context_stream_blur(FilterContext* context, const FilterSettings* settings, FILE* input, FILE* output,
+                               int width, int height) {
+    int result, error;
+    StageTimer timer;
+    if(input == NULL || output == NULL || width < 0 || height < 0 || settings->radius < 1){
+        errno = EINVAL;
+        return -1;
+    }
+    //reading, blurring and writing are interleaved, so they are timed as one
+    pthread_mutex_lock(&context->lock);
+    stats_begin(settings->stats, &timer);
+    result = stream_box_blur(input, output, width, height, settings->radius, context->pool);
+    error = errno;
+    stats_end(settings->stats, &timer, "stream blur", context->pool, (double)width * height);
+    pthread_mutex_unlock(&context->lock);
+    errno = error;
+    return result;
+}
+
+int filter_context_write_pixels(FilterContext* context, const FilterSettings* settings, FILE* file, Image* image, int height) {
+    int result = 0;
+    StageTimer timer;
+    WriteJob job;
+    //the workers write past the stdio buffer, straight to the descriptor
+    fflush(file);
+    job.image = image;
+    job.fd = fileno(file);
+    job.offset = ftell(file);
+    job.height = height;
+    atomic_init(&job.failed, 0);
+    pthread_mutex_lock(&context->lock);
+    stats_begin(settings->stats, &timer);
+    job.count = image->height < context->pool->size * BANDS_PER_WORKER ? image->height : context->pool->size * BANDS_PER_WORKER;
+    if(pool_run(context->pool, write_task, &job, job.count) != 0 || atomic_load(&job.failed))
+        result = -1;
+    stats_end(settings->stats, &timer, "output write", context->pool, (double)image->width * image->height);
+    pthread_mutex_unlock(&context->lock);
+    if(result != 0)
+        errno = EIO;
+    return result;
+}
+
+int filter_context_measure(FilterContext* context, RunStats* stats) {
+    int result = 0;
+    if(stats == NULL)
+        return 0;
+    //events are counted only where the stats could open the counters
+    pthread_mutex_lock(&context->lock);
+    if(pool_time_workers(context->pool, 1) != 0 || (stats->events != 0 && pool_count_events(context->pool, 1) != 0))
+        result = -1;
+    pthread_mutex_unlock(&context->lock);
+    return result;
+}
+
+void write_task(void* context, int task, int worker) {
+    WriteJob* job = (WriteJob*)context;
+    int start = (int)((long long)job->image->height * task / job->count);
+    int end = (int)((long long)job->image->height * (task + 1) / job->count);
+    if(writePixelRowsBMP(job->fd, job->offset, job->image->rows, job->image->width, job->height, start, end) != 0)
+        atomic_store(&job->failed, 1);
+}
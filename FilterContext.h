@@ -0,0 +1,121 @@
+/**
+* The filters as a library: a context owns the worker threads, and any number
+* of contexts filter images side by side in one process.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef FilterContext_H
+#define FilterContext_H 1
+#include <stdio.h>
+#include <pthread.h>
+#include "ImageBuffer.h"
+#include "ThreadPool.h"
+#include "FilterJobs.h"
+#include "FilterExport.h"
+
+//Calls on one context from several threads take turns, since its pool runs one
+//job at a time; threads that each use their own context filter concurrently.
+typedef struct FilterContext {
+	pthread_mutex_t lock;		//held while a filter runs on the pool
+	ThreadPool* pool;		//the context's own workers
+}FilterContext;
+
+//where filter_context_apply_radii puts each radius it renders. Both are called
+//without the context's lock, so they may call the context themselves.
+typedef struct RadiusSink {
+	Image* (*open)(void* context, int radius);		//image to render a radius into, NULL to stop
+	int (*close)(void* context, int radius, Image* output);	//take a rendered radius, -1 to stop
+	void* context;						//handed to open and close
+}RadiusSink;
+
+/**
+ * start a context and its worker threads.
+ *
+ * @param  threads: Number of workers, or 0 for one per online cpu
+ * @return The context, or NULL if memory ran out or the threads could not be started
+ */
+GOODMAN_API FilterContext* filter_context_create(int threads);
+
+
+/**
+ * stop the workers and release a context. No filter may be running on it.
+ *
+ * @param  context: The context to destroy, may be NULL
+ */
+GOODMAN_API void filter_context_destroy(FilterContext* context);
+
+
+/**
+ * filter an image into another of the same size on the context's workers.
+ * The pool in settings is ignored, and its stats may be shared between contexts.
+ *
+ * @param  context: The context
+ * @param  settings: The filter and its parameters
+ * @param  input: Image to read
+ * @param  output: Image to write, which must not be the input
+ * @return 0 on success, -1 with errno set to EINVAL if the settings or the
+ *         images are unusable, or to ENOMEM if memory ran out
+ */
+GOODMAN_API int filter_context_apply(FilterContext* context, const FilterSettings* settings, Image* input, Image* output);
+
+
+/**
+ * box blur an image at several radii from one summed-area table, built once on
+ * the context's workers. Each radius is rendered into the image the sink opens
+ * for it and handed back to the sink before the next one is opened.
+ *
+ * @param  context: The context
+ * @param  settings: Where the timings go; the pool and radius are ignored
+ * @param  input: Image to blur
+ * @param  radii: Radii to render, in order
+ * @param  count: Number of radii
+ * @param  sink: Where the rendered radii go
+ * @return 0 on success, -1 with errno set to EINVAL if a radius or an image is
+ *         unusable, to ENOMEM if memory ran out, or to ECANCELED if the sink stopped
+ */
+GOODMAN_API int filter_context_apply_radii(FilterContext* context, const FilterSettings* settings, Image* input,
+                               const int* radii, int count, RadiusSink* sink);
+
+
+/**
+ * box blur the pixel array of a BMP file into another on the context's workers,
+ * holding only a window of scanlines, as stream_box_blur does.
+ *
+ * @param  context: The context
+ * @param  settings: The radius, and where the timings go
+ * @param  input: Input file, positioned at the start of its pixel array
+ * @param  output: Output file, positioned where its pixel array starts
+ * @param  width: Width of the image in pixels
+ * @param  height: Number of scanlines in the image
+ * @return 0 on success, -1 with errno set as for stream_box_blur
+ */
+GOODMAN_API int filter_context_stream_blur(FilterContext* context, const FilterSettings* settings, FILE* input, FILE* output,
+                               int width, int height);
+
+
+/**
+ * write the pixel array of a BMP file on the context's workers, each encoding
+ * its own band of scanlines and writing it in place.
+ *
+ * @param  context: The context
+ * @param  settings: Where the timings go
+ * @param  file: The file, its headers written and its position where the pixels start
+ * @param  image: Image to write, with a row table
+ * @param  height: Height from the DIB header, negative for a top-down file
+ * @return 0 on success, -1 with errno set to EIO if a write failed
+ */
+GOODMAN_API int filter_context_write_pixels(FilterContext* context, const FilterSettings* settings, FILE* file, Image* image, int height);
+
+
+/**
+ * have the context's workers time their tasks for a run's stats, and count
+ * hardware events too where the stats count them.
+ *
+ * @param  context: The context
+ * @param  stats: The stats the timings are for
+ * @return 0 on success, -1 if memory ran out or the counters could not be opened
+ */
+GOODMAN_API int filter_context_measure(FilterContext* context, RunStats* stats);
+#endif
@@ -0,0 +1,18 @@
+/**
+* Marks the entry points of the goodmanfilters library. The library is built
+* with hidden visibility, so a shared build exports only what is marked here
+* and keeps the tasks and helpers that run outside a context's lock to itself.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef FilterExport_H
+#define FilterExport_H 1
+
+#if defined(__GNUC__) || defined(__clang__)
+#define GOODMAN_API __attribute__((visibility("default")))
+#else
+#define GOODMAN_API
+#endif
+#endif
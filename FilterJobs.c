@@ -0,0 +1,343 @@
+/**
+* File:   FilterJobs.c
+* Splits the blur, Gaussian blur and Swiss cheese filters into pool tasks.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <string.h>
+#include "FilterJobs.h"
+#include "FilterKernels.h"
+#include "BoxBlur.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//MACRO DEFINITIONS
+#define GAUSSIAN_PASSES 3
+
+////////////////////////////////////////////////////////////////////////////////
+//DATA STRUCTURES
+//what the tasks of one pool job work on: task i is tile i of tiles, or band i of
+//count equally sized bands of span rows or columns
+typedef struct Job {
+	Image* input;		//image the filter reads
+	Image* output;		//image the filter writes
+	int radius;		//radius of a box blur
+	int span;		//rows or columns split into bands
+	int count;		//number of bands
+	TileGrid* tiles;	//tiles of a tiled filter
+	SummedAreaTable* table;	//table of a summed-area blur
+	Circle* circles;	//cheese holes being placed
+	uint64_t seed;		//seed of the cheese hole layout
+	HoleMask* holes;	//spans of the cheese holes
+	const unsigned char* tint;	//red, green and blue added by the cheese filter
+	atomic_int failed;	//set by a task that ran out of memory
+}Job;
+
+typedef struct Stencil {
+    Pixel pixel[3][3];
+}Stencil;
+
+////////////////////////////////////////////////////////////////////////////////
+//FORWARD DECLARATIONS
+void job_band(Job* job, int task, int* start, int* end);
+int run_job(ThreadPool* pool, TaskFunction function, Job* job, int count);
+int run_bands(ThreadPool* pool, TaskFunction function, Job* job, int span);
+void sat_rows_task(void* context, int task, int worker);
+void sat_columns_task(void* context, int task, int worker);
+void sat_blur_task(void* context, int task, int worker);
+void blur_task(void* context, int task, int worker);
+void box_blur_task(void* context, int task, int worker);
+void blur_border_pixel(Image* input_arr, Image* output_arr, int x, int y);
+Pixel* blur_pixel(Stencil* stencil, Pixel* pixel, int num_pixels);
+void holes_task(void* context, int task, int worker);
+void hole_mask_task(void* context, int task, int worker);
+void cheese_task(void* context, int task, int worker);
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+int apply_filter(FilterSettings* settings, Image* input, Image* output){
+    int i, result = 0, gaussian_radii[GAUSSIAN_PASSES], height = input->height, width = input->width;
+    double pixels = (double)width * height;
+    StageTimer timer;
+    Image *scratch_arr, *spare;
+    TileGrid tiles;
+    Job job = {0};
+    job.input = input;
+    job.output = output;
+    job.tiles = &tiles;
+    atomic_init(&job.failed, 0);
+    stats_begin(settings->stats, &timer);
+    if(settings->filter_type == 'b'){
+        //the 3x3 blur works in tiles, larger blurs slide their window down bands of rows
+        job.radius = settings->radius;
+        if(job.radius > 1)
+            result = run_bands(settings->pool, box_blur_task, &job, height);
+        else {
+            //3 bytes in and 3 out per pixel, plus a one pixel halo of input
+            tile_grid_init(&tiles, width, height, 2 * sizeof(Pixel), 1);
+            result = run_job(settings->pool, blur_task, &job, tile_grid_count(&tiles));
+        }
+    }
+    else if(settings->filter_type == 'g'){
+        //ping-pong input -> output -> scratch -> output, so the last pass lands in output
+        gaussian_box_radii(settings->sigma, GAUSSIAN_PASSES, gaussian_radii);
+        scratch_arr = image_create(width, height);
+        if(scratch_arr == NULL)
+            result = -1;
+        else {
+            job.output = GAUSSIAN_PASSES % 2 == 1 ? output : scratch_arr;
+            spare = job.output == output ? scratch_arr : output;
+        }
+        for(i = 0; i < GAUSSIAN_PASSES && result == 0; i++){
+            //a band's box reaches into its neighbours' rows, so each pass is a separate job
+            if(i > 0){
+                job.input = job.output;
+                job.output = spare;
+                spare = job.input;
+            }
+            job.radius = gaussian_radii[i];
+            result = run_bands(settings->pool, box_blur_task, &job, height);
+        }
+        image_destroy(scratch_arr);
+    }
+    else {
+        //holes are laid out first, so each tile is tinted and holed in one sweep
+        job.holes = cheese_holes(settings, input);
+        stats_end(settings->stats, &timer, "holes", settings->pool, pixels);
+        stats_begin(settings->stats, &timer);
+        if(job.holes == NULL)
+            result = -1;
+        else {
+            job.tint = settings->tint;
+            tile_grid_init(&tiles, width, height, 2 * sizeof(Pixel), 0);
+            result = run_job(settings->pool, cheese_task, &job, tile_grid_count(&tiles));
+            hole_mask_destroy(job.holes);
+        }
+    }
+    stats_end(settings->stats, &timer, "filter", settings->pool, pixels);
+    return result;
+}
+
+HoleMask* cheese_holes(FilterSettings* settings, Image* image){
+    int count = hole_count(image->width, image->height);
+    Job job = {0};
+    atomic_init(&job.failed, 0);
+    job.circles = (Circle*)malloc((count > 0 ? count : 1) * sizeof(Circle));
+    if(job.circles == NULL)
+        return NULL;
+    job.seed = settings->seed;
+    job.input = image;
+    if(run_bands(settings->pool, holes_task, &job, count) == 0)
+        job.holes = hole_mask_create(image->width, image->height, job.circles, count);
+    //each strip of rows rasterises only the holes filed under it
+    if(job.holes != NULL && run_job(settings->pool, hole_mask_task, &job, hole_mask_strips(job.holes)) != 0){
+        hole_mask_destroy(job.holes);
+        job.holes = NULL;
+    }
+    free(job.circles);
+    return job.holes;
+}
+
+SummedAreaTable* blur_table(FilterSettings* settings, Image* input){
+    StageTimer timer;
+    Job job = {0};
+    atomic_init(&job.failed, 0);
+    job.table = sat_create(input->width, input->height);
+    if(job.table == NULL)
+        return NULL;
+    job.input = input;
+    stats_begin(settings->stats, &timer);
+    //the rows are summed before the columns, each a band at a time
+    if(run_bands(settings->pool, sat_rows_task, &job, input->height) != 0
+       || run_bands(settings->pool, sat_columns_task, &job, input->width) != 0){
+        sat_destroy(job.table);
+        job.table = NULL;
+    }
+    stats_end(settings->stats, &timer, "table", settings->pool, (double)input->width * input->height);
+    return job.table;
+}
+
+int blur_from_table(FilterSettings* settings, SummedAreaTable* table, int radius, Image* output){
+    int result;
+    StageTimer timer;
+    Job job = {0};
+    atomic_init(&job.failed, 0);
+    job.table = table;
+    job.output = output;
+    job.radius = radius;
+    stats_begin(settings->stats, &timer);
+    result = run_bands(settings->pool, sat_blur_task, &job, output->height);
+    stats_end(settings->stats, &timer, "filter", settings->pool, (double)output->width * output->height);
+    return result;
+}
+
+void job_band(Job* job, int task, int* start, int* end){
+    *start = (int)((long long)job->span * task / job->count);
+    *end = (int)((long long)job->span * (task + 1) / job->count);
+}
+
+int run_job(ThreadPool* pool, TaskFunction function, Job* job, int count){
+    if(pool_run(pool, function, job, count) != 0 || atomic_load(&job->failed))
+        return -1;
+    return 0;
+}
+
+int run_bands(ThreadPool* pool, TaskFunction function, Job* job, int span){
+    job->span = span;
+    job->count = span < pool->size * BANDS_PER_WORKER ? span : pool->size * BANDS_PER_WORKER;
+    return run_job(pool, function, job, job->count);
+}
+
+void blur_task(void* context, int task, int worker){
+    Job* job = (Job*)context;
+    Tile tile;
+    tile_grid_tile(job->tiles, task, &tile);
+    blur_filter(job->input, job->output, &tile);
+}
+
+void box_blur_task(void* context, int task, int worker){
+    Job* job = (Job*)context;
+    int start, end;
+    job_band(job, task, &start, &end);
+    if(box_blur_rows(job->input, job->output, job->radius, start, end) != 0)
+        atomic_store(&job->failed, 1);
+}
+
+void sat_rows_task(void* context, int task, int worker){
+    Job* job = (Job*)context;
+    int start, end;
+    job_band(job, task, &start, &end);
+    sat_scan_rows(job->table, job->input, start, end);
+}
+
+void sat_columns_task(void* context, int task, int worker){
+    Job* job = (Job*)context;
+    int start, end;
+    job_band(job, task, &start, &end);
+    sat_scan_columns(job->table, start, end);
+}
+
+void sat_blur_task(void* context, int task, int worker){
+    Job* job = (Job*)context;
+    int start, end;
+    job_band(job, task, &start, &end);
+    if(sat_blur_rows(job->table, job->output, job->radius, start, end) != 0)
+        atomic_store(&job->failed, 1);
+}
+
+void blur_filter(Image* input_arr, Image* output_arr, Tile* tile) {
+    int i, j, height = input_arr->height, width = input_arr->width;
+    //columns of this tile that have a neighbour on both sides
+    int first = tile->x0 > 1 ? tile->x0 : 1;
+    int last = tile->x1 < width - 1 ? tile->x1 : width - 1;
+    const FilterKernels* kernels = filter_kernels();
+    Pixel *row, *out;
+    //neighbours are read from input_arr, so each tile only writes its own pixels
+    for(i = tile->y0; i < tile->y1; i++){
+        row = image_row(input_arr, i);
+        out = image_row(output_arr, i);
+        //left edge and left corners
+        if(tile->x0 == 0)
+            blur_border_pixel(input_arr, output_arr, 0, i);
+        if(height == 1)
+            for(j = first; j < last; j++)
+                blur_border_pixel(input_arr, output_arr, j, i);
+        //upper edge
+        else if(i == 0)
+            kernels->blur_edge(row, image_row(input_arr, 1), out, first, last);
+        //bottom edge
+        else if(i == height - 1)
+            kernels->blur_edge(row, image_row(input_arr, i - 1), out, first, last);
+        //pixels not on the border
+        else
+            kernels->blur_interior(image_row(input_arr, i - 1), row, image_row(input_arr, i + 1), out, first, last);
+        //right edge and right corners
+        if(tile->x1 == width && width > 1)
+            blur_border_pixel(input_arr, output_arr, width - 1, i);
+    }
+}
+
+void blur_border_pixel(Image* input_arr, Image* output_arr, int x, int y) {
+    int i, j, num_pixels = 0;
+    Stencil stencil;
+    Pixel pixel;
+    //neighbours that fall outside the image are zeroed and left out of the average
+    for(i = 0; i < 3; i++)
+        for(j = 0; j < 3; j++){
+            if(y + i - 1 >= 0 && y + i - 1 < input_arr->height && x + j - 1 >= 0 && x + j - 1 < input_arr->width){
+                stencil.pixel[i][j] = image_row(input_arr, y + i - 1)[x + j - 1];
+                num_pixels++;
+            }
+            else {
+                stencil.pixel[i][j].red = 0;
+                stencil.pixel[i][j].green = 0;
+                stencil.pixel[i][j].blue = 0;
+            }
+        }
+    image_row(output_arr, y)[x] = *blur_pixel(&stencil, &pixel, num_pixels);
+}
+
+Pixel* blur_pixel(Stencil* stencil, Pixel* pixel, int num_pixels) {
+    int i, j, red_sum = 0, green_sum = 0, blue_sum = 0;
+    for(i = 0; i < 3; i++)
+        for(j = 0; j < 3; j++){
+            red_sum += stencil->pixel[i][j].red;
+            green_sum += stencil->pixel[i][j].green;
+            blue_sum += stencil->pixel[i][j].blue;
+        }
+    pixel->red = red_sum / num_pixels;
+    pixel->green = green_sum / num_pixels;
+    pixel->blue = blue_sum / num_pixels;
+    return pixel;
+}
+
+void holes_task(void* context, int task, int worker){
+    Job* job = (Job*)context;
+    int start, end;
+    job_band(job, task, &start, &end);
+    hole_place(job->circles, start, end, job->input->width, job->input->height, job->seed);
+}
+
+void hole_mask_task(void* context, int task, int worker){
+    Job* job = (Job*)context;
+    hole_mask_fill(job->holes, task);
+}
+
+void cheese_task(void* context, int task, int worker){
+    Job* job = (Job*)context;
+    Tile tile;
+    tile_grid_tile(job->tiles, task, &tile);
+    cheese_filter(job->input, job->output, job->holes, job->tint, &tile);
+}
+
+void cheese_filter(Image* input_arr, Image* output_arr, HoleMask* holes, const unsigned char* tint, Tile* tile) {
+    int i, k, count, x, start, end;
+    const Span* spans;
+    unsigned char *row, *out, amount[3];
+    const FilterKernels* kernels = filter_kernels();
+    //images mapped from a file keep its blue, green, red order
+    amount[0] = input_arr->blue_first ? tint[2] : tint[0];
+    amount[1] = tint[1];
+    amount[2] = input_arr->blue_first ? tint[0] : tint[2];
+    for(i = tile->y0; i < tile->y1; i++) {
+        row = (unsigned char*)image_row(input_arr, i);
+        out = (unsigned char*)image_row(output_arr, i);
+        spans = hole_mask_row(holes, i, &count);
+        //apply yellow tint between the holes and clear the holes, writing each pixel once
+        for(k = 0, x = tile->x0; k < count && spans[k].x0 < tile->x1; k++){
+            if(spans[k].x1 <= x)
+                continue;
+            start = spans[k].x0 > x ? spans[k].x0 : x;
+            end = spans[k].x1 < tile->x1 ? spans[k].x1 : tile->x1;
+            if(start > x)
+                kernels->tint(out + 3 * x, row + 3 * x, amount, start - x);
+            memset(out + 3 * start, 0, 3 * (end - start));
+            x = end;
+        }
+        if(x < tile->x1)
+            kernels->tint(out + 3 * x, row + 3 * x, amount, tile->x1 - x);
+    }
+}
@@ -0,0 +1,100 @@
+/**
+* Runs the filters over an image on a pool of worker threads, splitting each
+* filter into cache-sized tiles or bands of rows.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef FilterJobs_H
+#define FilterJobs_H 1
+#include <stdint.h>
+#include "ImageBuffer.h"
+#include "TileScheduler.h"
+#include "ThreadPool.h"
+#include "SummedAreaTable.h"
+#include "HoleMask.h"
+#include "RunStats.h"
+
+//row and column bands per worker, so stealing has something to even out
+#define BANDS_PER_WORKER 4
+
+//what apply_filter does to every image of a run
+typedef struct FilterSettings {
+	ThreadPool* pool;	//workers the filter runs on
+	char filter_type;	//b for box blur, g for Gaussian blur, c for Swiss cheese
+	int radius;		//radius of the box blur
+	double sigma;		//standard deviation of the Gaussian blur
+	unsigned char tint[3];	//red, green and blue added by the cheese filter
+	uint64_t seed;		//seed of the cheese hole layout
+	RunStats* stats;	//where the filter's stage timings go, NULL to not keep them
+}FilterSettings;
+
+/**
+ * filter an image into another of the same size on the settings' pool.
+ *
+ * @param  settings: The filter and its parameters
+ * @param  input: Image to read
+ * @param  output: Image to write, which must not be the input
+ * @return 0 on success, -1 if memory ran out, leaving output partly written
+ */
+int apply_filter(FilterSettings* settings, Image* input, Image* output);
+
+
+/**
+ * lay out the holes of the cheese filter for an image on the settings' pool and
+ * rasterise them.
+ *
+ * @param  settings: The filter parameters, whose seed places the holes
+ * @param  image: Image the holes are cut into
+ * @return The filled mask, to be released with hole_mask_destroy, or NULL if
+ *         memory ran out
+ */
+HoleMask* cheese_holes(FilterSettings* settings, Image* image);
+
+
+/**
+ * 3x3 box blur of one tile, averaging only the neighbours inside the image.
+ *
+ * @param  input_arr: Image to read
+ * @param  output_arr: Image to write
+ * @param  tile: Pixels of the output to write
+ */
+void blur_filter(Image* input_arr, Image* output_arr, Tile* tile);
+
+
+/**
+ * Swiss cheese filter of one tile: tint the pixels between the holes and
+ * clear the holes.
+ *
+ * @param  input_arr: Image to read
+ * @param  output_arr: Image to write
+ * @param  holes: Filled mask of the holes
+ * @param  tint: Red, green and blue to add
+ * @param  tile: Pixels of the output to write
+ */
+void cheese_filter(Image* input_arr, Image* output_arr, HoleMask* holes, const unsigned char* tint, Tile* tile);
+
+
+/**
+ * build the summed-area table of an image on the settings' pool, for
+ * blur_from_table to render box blurs of any radius from.
+ *
+ * @param  settings: Where the work runs and its timing goes
+ * @param  input: Image to sum
+ * @return The table, to be released with sat_destroy, or NULL if memory ran out
+ */
+SummedAreaTable* blur_table(FilterSettings* settings, Image* input);
+
+
+/**
+ * box blur of the image a table was built from, on the settings' pool.
+ *
+ * @param  settings: Where the work runs and its timing goes
+ * @param  table: Table from blur_table
+ * @param  radius: Number of neighbours on each side of a pixel
+ * @param  output: Image to write, the size of the table
+ * @return 0 on success, -1 if memory ran out, leaving output partly written
+ */
+int blur_from_table(FilterSettings* settings, SummedAreaTable* table, int radius, Image* output);
+#endif
@@ -0,0 +1,339 @@
+/**
+* File:   FilterKernels.c
+* Scalar and SIMD inner loops of the filters, with run time cpu dispatch.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "FilterKernels.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILTER_KERNELS_X86 1
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//MACRO DEFINITIONS
+//fixed-point reciprocals: (sum * RECIP_N) >> 16 == sum / N for any sum of N channel bytes
+#define RECIP_9 7282
+#define RECIP_6 10923
+
+////////////////////////////////////////////////////////////////////////////////
+//SCALAR REFERENCE
+static void blur_interior_scalar(const Pixel* above, const Pixel* row, const Pixel* below, Pixel* out, int start, int end) {
+    int j;
+    for(j = start; j < end; j++){
+        out[j].red = (above[j - 1].red + above[j].red + above[j + 1].red
+                + row[j - 1].red + row[j].red + row[j + 1].red
+                + below[j - 1].red + below[j].red + below[j + 1].red) / 9;
+        out[j].green = (above[j - 1].green + above[j].green + above[j + 1].green
+                + row[j - 1].green + row[j].green + row[j + 1].green
+                + below[j - 1].green + below[j].green + below[j + 1].green) / 9;
+        out[j].blue = (above[j - 1].blue + above[j].blue + above[j + 1].blue
+                + row[j - 1].blue + row[j].blue + row[j + 1].blue
+                + below[j - 1].blue + below[j].blue + below[j + 1].blue) / 9;
+    }
+}
+
+static void blur_edge_scalar(const Pixel* row, const Pixel* neighbour, Pixel* out, int start, int end) {
+    int j;
+    for(j = start; j < end; j++){
+        out[j].red = (row[j - 1].red + row[j].red + row[j + 1].red
+                + neighbour[j - 1].red + neighbour[j].red + neighbour[j + 1].red) / 6;
+        out[j].green = (row[j - 1].green + row[j].green + row[j + 1].green
+                + neighbour[j - 1].green + neighbour[j].green + neighbour[j + 1].green) / 6;
+        out[j].blue = (row[j - 1].blue + row[j].blue + row[j + 1].blue
+                + neighbour[j - 1].blue + neighbour[j].blue + neighbour[j + 1].blue) / 6;
+    }
+}
+
+static void swap_red_blue_scalar(unsigned char* out, const unsigned char* in, int count) {
+    int j;
+    for(j = 0; j < count * 3; j += 3){
+        out[j] = in[j + 2];
+        out[j + 1] = in[j + 1];
+        out[j + 2] = in[j];
+    }
+}
+
+//the clamp is written without branches, so compilers can vectorise it for any target
+static void tint_scalar(unsigned char* out, const unsigned char* in, const unsigned char* amount, int count) {
+    int j, value;
+    for(j = 0; j < count * 3; j += 3){
+        value = in[j] + amount[0];
+        out[j] = value < 255 ? value : 255;
+        value = in[j + 1] + amount[1];
+        out[j + 1] = value < 255 ? value : 255;
+        value = in[j + 2] + amount[2];
+        out[j + 2] = value < 255 ? value : 255;
+    }
+}
+
+static const FilterKernels scalar_kernels = {"scalar", blur_interior_scalar, blur_edge_scalar, swap_red_blue_scalar, tint_scalar};
+
+#ifdef FILTER_KERNELS_X86
+////////////////////////////////////////////////////////////////////////////////
+//VECTOR HELPERS
+//The vector kernels treat a span of pixels as a run of channel bytes: byte k of
+//the output averages bytes k - 3, k and k + 3 of each contributing row. Sums are
+//widened to 16 bits, divided with a fixed-point reciprocal and packed back down.
+//Whatever is left over after the last full vector falls back to these.
+static void blur_bytes_3(const unsigned char* a, const unsigned char* b, const unsigned char* c, unsigned char* out, int k, int end) {
+    for(; k < end; k++)
+        out[k] = (a[k - 3] + a[k] + a[k + 3] + b[k - 3] + b[k] + b[k + 3] + c[k - 3] + c[k] + c[k + 3]) / 9;
+}
+
+static void blur_bytes_2(const unsigned char* a, const unsigned char* b, unsigned char* out, int k, int end) {
+    for(; k < end; k++)
+        out[k] = (a[k - 3] + a[k] + a[k + 3] + b[k - 3] + b[k] + b[k + 3]) / 6;
+}
+
+//The tint kernels add a saturating per-channel constant. A pixel is 3 bytes, so the
+//constant repeats every 3 vectors: each step loads three vectors and adds the three
+//rotations of the amounts that line up with them.
+static void tint_pattern(unsigned char* pattern, const unsigned char* amount, int length) {
+    int k;
+    for(k = 0; k < length; k++)
+        pattern[k] = amount[k % 3];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//SSE2 (16 channel bytes per step)
+__attribute__((target("sse2"), always_inline))
+static inline void sse2_add_row(const unsigned char* p, __m128i* lo, __m128i* hi) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i l = _mm_loadu_si128((const __m128i*)(p - 3));
+    __m128i c = _mm_loadu_si128((const __m128i*)p);
+    __m128i r = _mm_loadu_si128((const __m128i*)(p + 3));
+    *lo = _mm_add_epi16(*lo, _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(l, zero), _mm_unpacklo_epi8(c, zero)), _mm_unpacklo_epi8(r, zero)));
+    *hi = _mm_add_epi16(*hi, _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(l, zero), _mm_unpackhi_epi8(c, zero)), _mm_unpackhi_epi8(r, zero)));
+}
+
+__attribute__((target("sse2")))
+static void blur_interior_sse2(const Pixel* above, const Pixel* row, const Pixel* below, Pixel* out, int start, int end) {
+    const unsigned char *a = (const unsigned char*)above, *b = (const unsigned char*)row, *c = (const unsigned char*)below;
+    unsigned char* o = (unsigned char*)out;
+    const __m128i recip = _mm_set1_epi16(RECIP_9);
+    int k = start * 3, stop = end * 3;
+    for(; k + 16 <= stop; k += 16){
+        __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+        sse2_add_row(a + k, &lo, &hi);
+        sse2_add_row(b + k, &lo, &hi);
+        sse2_add_row(c + k, &lo, &hi);
+        _mm_storeu_si128((__m128i*)(o + k), _mm_packus_epi16(_mm_mulhi_epu16(lo, recip), _mm_mulhi_epu16(hi, recip)));
+    }
+    blur_bytes_3(a, b, c, o, k, stop);
+}
+
+__attribute__((target("sse2")))
+static void blur_edge_sse2(const Pixel* row, const Pixel* neighbour, Pixel* out, int start, int end) {
+    const unsigned char *a = (const unsigned char*)row, *b = (const unsigned char*)neighbour;
+    unsigned char* o = (unsigned char*)out;
+    const __m128i recip = _mm_set1_epi16(RECIP_6);
+    int k = start * 3, stop = end * 3;
+    for(; k + 16 <= stop; k += 16){
+        __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+        sse2_add_row(a + k, &lo, &hi);
+        sse2_add_row(b + k, &lo, &hi);
+        _mm_storeu_si128((__m128i*)(o + k), _mm_packus_epi16(_mm_mulhi_epu16(lo, recip), _mm_mulhi_epu16(hi, recip)));
+    }
+    blur_bytes_2(a, b, o, k, stop);
+}
+
+__attribute__((target("sse2")))
+static void tint_sse2(unsigned char* out, const unsigned char* in, const unsigned char* amount, int count) {
+    unsigned char pattern[48];
+    int k, stop = count * 3;
+    tint_pattern(pattern, amount, 48);
+    const __m128i a0 = _mm_loadu_si128((const __m128i*)pattern);
+    const __m128i a1 = _mm_loadu_si128((const __m128i*)(pattern + 16));
+    const __m128i a2 = _mm_loadu_si128((const __m128i*)(pattern + 32));
+    for(k = 0; k + 48 <= stop; k += 48){
+        _mm_storeu_si128((__m128i*)(out + k), _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(in + k)), a0));
+        _mm_storeu_si128((__m128i*)(out + k + 16), _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(in + k + 16)), a1));
+        _mm_storeu_si128((__m128i*)(out + k + 32), _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(in + k + 32)), a2));
+    }
+    tint_scalar(out + k, in + k, amount, (stop - k) / 3);
+}
+
+//the swizzle needs the byte shuffle from SSSE3, so plain SSE2 keeps the scalar one
+static const FilterKernels sse2_kernels = {"sse2", blur_interior_sse2, blur_edge_sse2, swap_red_blue_scalar, tint_sse2};
+
+////////////////////////////////////////////////////////////////////////////////
+//AVX2 (32 channel bytes per step)
+//unpack and pack both work within 128-bit lanes, so byte order is preserved
+__attribute__((target("avx2"), always_inline))
+static inline void avx2_add_row(const unsigned char* p, __m256i* lo, __m256i* hi) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i l = _mm256_loadu_si256((const __m256i*)(p - 3));
+    __m256i c = _mm256_loadu_si256((const __m256i*)p);
+    __m256i r = _mm256_loadu_si256((const __m256i*)(p + 3));
+    *lo = _mm256_add_epi16(*lo, _mm256_add_epi16(_mm256_add_epi16(_mm256_unpacklo_epi8(l, zero), _mm256_unpacklo_epi8(c, zero)), _mm256_unpacklo_epi8(r, zero)));
+    *hi = _mm256_add_epi16(*hi, _mm256_add_epi16(_mm256_add_epi16(_mm256_unpackhi_epi8(l, zero), _mm256_unpackhi_epi8(c, zero)), _mm256_unpackhi_epi8(r, zero)));
+}
+
+__attribute__((target("avx2")))
+static void blur_interior_avx2(const Pixel* above, const Pixel* row, const Pixel* below, Pixel* out, int start, int end) {
+    const unsigned char *a = (const unsigned char*)above, *b = (const unsigned char*)row, *c = (const unsigned char*)below;
+    unsigned char* o = (unsigned char*)out;
+    const __m256i recip = _mm256_set1_epi16(RECIP_9);
+    int k = start * 3, stop = end * 3;
+    for(; k + 32 <= stop; k += 32){
+        __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+        avx2_add_row(a + k, &lo, &hi);
+        avx2_add_row(b + k, &lo, &hi);
+        avx2_add_row(c + k, &lo, &hi);
+        _mm256_storeu_si256((__m256i*)(o + k), _mm256_packus_epi16(_mm256_mulhi_epu16(lo, recip), _mm256_mulhi_epu16(hi, recip)));
+    }
+    blur_bytes_3(a, b, c, o, k, stop);
+}
+
+__attribute__((target("avx2")))
+static void blur_edge_avx2(const Pixel* row, const Pixel* neighbour, Pixel* out, int start, int end) {
+    const unsigned char *a = (const unsigned char*)row, *b = (const unsigned char*)neighbour;
+    unsigned char* o = (unsigned char*)out;
+    const __m256i recip = _mm256_set1_epi16(RECIP_6);
+    int k = start * 3, stop = end * 3;
+    for(; k + 32 <= stop; k += 32){
+        __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+        avx2_add_row(a + k, &lo, &hi);
+        avx2_add_row(b + k, &lo, &hi);
+        _mm256_storeu_si256((__m256i*)(o + k), _mm256_packus_epi16(_mm256_mulhi_epu16(lo, recip), _mm256_mulhi_epu16(hi, recip)));
+    }
+    blur_bytes_2(a, b, o, k, stop);
+}
+
+//Byte shuffles stay within 128-bit lanes, so each lane takes 5 whole pixels: the
+//lanes load 15 bytes apart and the upper store overwrites byte 15 of the lower one.
+__attribute__((target("avx2")))
+static void swap_red_blue_avx2(unsigned char* out, const unsigned char* in, int count) {
+    const __m128i order = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    const __m256i shuffle = _mm256_set_m128i(order, order);
+    int k = 0, stop = count * 3;
+    for(; k + 31 <= stop; k += 30){
+        __m256i v = _mm256_shuffle_epi8(_mm256_loadu2_m128i((const __m128i*)(in + k + 15), (const __m128i*)(in + k)), shuffle);
+        _mm_storeu_si128((__m128i*)(out + k), _mm256_castsi256_si128(v));
+        _mm_storeu_si128((__m128i*)(out + k + 15), _mm256_extracti128_si256(v, 1));
+    }
+    swap_red_blue_scalar(out + k, in + k, (stop - k) / 3);
+}
+
+__attribute__((target("avx2")))
+static void tint_avx2(unsigned char* out, const unsigned char* in, const unsigned char* amount, int count) {
+    unsigned char pattern[96];
+    int k, stop = count * 3;
+    tint_pattern(pattern, amount, 96);
+    const __m256i a0 = _mm256_loadu_si256((const __m256i*)pattern);
+    const __m256i a1 = _mm256_loadu_si256((const __m256i*)(pattern + 32));
+    const __m256i a2 = _mm256_loadu_si256((const __m256i*)(pattern + 64));
+    for(k = 0; k + 96 <= stop; k += 96){
+        _mm256_storeu_si256((__m256i*)(out + k), _mm256_adds_epu8(_mm256_loadu_si256((const __m256i*)(in + k)), a0));
+        _mm256_storeu_si256((__m256i*)(out + k + 32), _mm256_adds_epu8(_mm256_loadu_si256((const __m256i*)(in + k + 32)), a1));
+        _mm256_storeu_si256((__m256i*)(out + k + 64), _mm256_adds_epu8(_mm256_loadu_si256((const __m256i*)(in + k + 64)), a2));
+    }
+    tint_sse2(out + k, in + k, amount, (stop - k) / 3);
+}
+
+static const FilterKernels avx2_kernels = {"avx2", blur_interior_avx2, blur_edge_avx2, swap_red_blue_avx2, tint_avx2};
+
+////////////////////////////////////////////////////////////////////////////////
+//AVX-512BW (64 channel bytes per step)
+__attribute__((target("avx512bw"), always_inline))
+static inline void avx512_add_row(const unsigned char* p, __m512i* lo, __m512i* hi) {
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i l = _mm512_loadu_si512((const void*)(p - 3));
+    __m512i c = _mm512_loadu_si512((const void*)p);
+    __m512i r = _mm512_loadu_si512((const void*)(p + 3));
+    *lo = _mm512_add_epi16(*lo, _mm512_add_epi16(_mm512_add_epi16(_mm512_unpacklo_epi8(l, zero), _mm512_unpacklo_epi8(c, zero)), _mm512_unpacklo_epi8(r, zero)));
+    *hi = _mm512_add_epi16(*hi, _mm512_add_epi16(_mm512_add_epi16(_mm512_unpackhi_epi8(l, zero), _mm512_unpackhi_epi8(c, zero)), _mm512_unpackhi_epi8(r, zero)));
+}
+
+__attribute__((target("avx512bw")))
+static void blur_interior_avx512(const Pixel* above, const Pixel* row, const Pixel* below, Pixel* out, int start, int end) {
+    const unsigned char *a = (const unsigned char*)above, *b = (const unsigned char*)row, *c = (const unsigned char*)below;
+    unsigned char* o = (unsigned char*)out;
+    const __m512i recip = _mm512_set1_epi16(RECIP_9);
+    int k = start * 3, stop = end * 3;
+    for(; k + 64 <= stop; k += 64){
+        __m512i lo = _mm512_setzero_si512(), hi = _mm512_setzero_si512();
+        avx512_add_row(a + k, &lo, &hi);
+        avx512_add_row(b + k, &lo, &hi);
+        avx512_add_row(c + k, &lo, &hi);
+        _mm512_storeu_si512((void*)(o + k), _mm512_packus_epi16(_mm512_mulhi_epu16(lo, recip), _mm512_mulhi_epu16(hi, recip)));
+    }
+    blur_bytes_3(a, b, c, o, k, stop);
+}
+
+__attribute__((target("avx512bw")))
+static void blur_edge_avx512(const Pixel* row, const Pixel* neighbour, Pixel* out, int start, int end) {
+    const unsigned char *a = (const unsigned char*)row, *b = (const unsigned char*)neighbour;
+    unsigned char* o = (unsigned char*)out;
+    const __m512i recip = _mm512_set1_epi16(RECIP_6);
+    int k = start * 3, stop = end * 3;
+    for(; k + 64 <= stop; k += 64){
+        __m512i lo = _mm512_setzero_si512(), hi = _mm512_setzero_si512();
+        avx512_add_row(a + k, &lo, &hi);
+        avx512_add_row(b + k, &lo, &hi);
+        _mm512_storeu_si512((void*)(o + k), _mm512_packus_epi16(_mm512_mulhi_epu16(lo, recip), _mm512_mulhi_epu16(hi, recip)));
+    }
+    blur_bytes_2(a, b, o, k, stop);
+}
+
+__attribute__((target("avx512bw")))
+static void tint_avx512(unsigned char* out, const unsigned char* in, const unsigned char* amount, int count) {
+    unsigned char pattern[192];
+    int k, stop = count * 3;
+    tint_pattern(pattern, amount, 192);
+    const __m512i a0 = _mm512_loadu_si512((const void*)pattern);
+    const __m512i a1 = _mm512_loadu_si512((const void*)(pattern + 64));
+    const __m512i a2 = _mm512_loadu_si512((const void*)(pattern + 128));
+    for(k = 0; k + 192 <= stop; k += 192){
+        _mm512_storeu_si512((void*)(out + k), _mm512_adds_epu8(_mm512_loadu_si512((const void*)(in + k)), a0));
+        _mm512_storeu_si512((void*)(out + k + 64), _mm512_adds_epu8(_mm512_loadu_si512((const void*)(in + k + 64)), a1));
+        _mm512_storeu_si512((void*)(out + k + 128), _mm512_adds_epu8(_mm512_loadu_si512((const void*)(in + k + 128)), a2));
+    }
+    tint_avx2(out + k, in + k, amount, (stop - k) / 3);
+}
+
+//every cpu with AVX-512BW also has AVX2, which is enough for the swizzle
+static const FilterKernels avx512_kernels = {"avx512", blur_interior_avx512, blur_edge_avx512, swap_red_blue_avx2, tint_avx512};
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//DISPATCH
+static const FilterKernels* selected_kernels;
+static pthread_once_t select_once = PTHREAD_ONCE_INIT;
+
+static void select_kernels(void) {
+    const char* forced = getenv("GOODMAN_ISA");
+    if(forced != NULL && (selected_kernels = filter_kernels_named(forced)) != NULL)
+        return;
+    if((selected_kernels = filter_kernels_named("avx512")) == NULL
+       && (selected_kernels = filter_kernels_named("avx2")) == NULL
+       && (selected_kernels = filter_kernels_named("sse2")) == NULL)
+        selected_kernels = &scalar_kernels;
+}
+
+const FilterKernels* filter_kernels(void) {
+    pthread_once(&select_once, select_kernels);
+    return selected_kernels;
+}
+
+const FilterKernels* filter_kernels_named(const char* isa) {
+    if(strcmp(isa, "scalar") == 0)
+        return &scalar_kernels;
+#ifdef FILTER_KERNELS_X86
+    __builtin_cpu_init();
+    if(strcmp(isa, "sse2") == 0 && __builtin_cpu_supports("sse2"))
+        return &sse2_kernels;
+    if(strcmp(isa, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+        return &avx2_kernels;
+    if(strcmp(isa, "avx512") == 0 && __builtin_cpu_supports("avx512bw"))
+        return &avx512_kernels;
+#endif
+    return NULL;
+}
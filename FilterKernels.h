@@ -0,0 +1,55 @@
+/**
+* Inner loops of the filters, with a portable scalar reference version and
+* vectorised versions chosen at run time for the cpu the program runs on.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef FilterKernels_H
+#define FilterKernels_H 1
+#include "PixelProcessor.h"
+
+typedef struct FilterKernels {
+	const char* isa;	//name of the instruction set the kernels use
+	/**
+	 * 3x3 box blur of pixels start to end - 1 of a row that has a row above and below it.
+	 * Every pixel in the span must have a left and right neighbour.
+	 */
+	void (*blur_interior)(const Pixel* above, const Pixel* row, const Pixel* below, Pixel* out, int start, int end);
+	/**
+	 * 3x2 box blur of pixels start to end - 1 of the upper or bottom row, whose only
+	 * vertical neighbour is the given row.
+	 */
+	void (*blur_edge)(const Pixel* row, const Pixel* neighbour, Pixel* out, int start, int end);
+	/**
+	 * copies count 3 byte pixels while swapping their first and last bytes, which
+	 * converts between the blue-green-red order of a BMP file and Pixel.
+	 */
+	void (*swap_red_blue)(unsigned char* out, const unsigned char* in, int count);
+	/**
+	 * copies count 3 byte pixels while adding amount[c] to byte c of each pixel,
+	 * clamping every byte at 255.
+	 */
+	void (*tint)(unsigned char* out, const unsigned char* in, const unsigned char* amount, int count);
+}FilterKernels;
+
+/**
+ * kernels for the best instruction set the cpu supports. The choice is made on
+ * the first call and can be forced by naming an instruction set in the
+ * GOODMAN_ISA environment variable (scalar, sse2, avx2 or avx512).
+ *
+ * @return The selected kernel table
+ */
+const FilterKernels* filter_kernels(void);
+
+
+/**
+ * kernels for a specific instruction set, for checking vectorised kernels
+ * against the scalar reference.
+ *
+ * @param  isa: Name of the instruction set (scalar, sse2, avx2 or avx512)
+ * @return The kernel table, or NULL if the name is unknown or the cpu lacks it
+ */
+const FilterKernels* filter_kernels_named(const char* isa);
+#endif
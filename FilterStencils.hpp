@@ -0,0 +1,111 @@
+/**
+* Box blur stencils as C++ templates over the kernel size and the pixel format.
+* Every size and format is its own instantiation, with the stencil unrolled at
+* compile time and the average divided by a constant, and none of them
+* allocates. Like the C filters, a pixel near the border is the floor of the
+* average of the neighbours inside the image.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef FilterStencils_HPP
+#define FilterStencils_HPP 1
+#include <type_traits>
+#include <utility>
+#include "ImageBuffer.hpp"
+
+namespace goodman {
+
+namespace detail {
+
+//call f with std::integral_constant<int, 0> up to <int, N - 1>, unrolled
+template<class F, int... I>
+inline void unroll(F&& f, std::integer_sequence<int, I...>) {
+	(f(std::integral_constant<int, I>()), ...);
+}
+
+template<int N, class F>
+inline void unroll(F&& f) {
+	unroll(std::forward<F>(f), std::make_integer_sequence<int, N>());
+}
+
+//one pixel whose whole Size x Size box is inside the image; rows[i] is the row i - Size / 2 away
+template<int Size, class Format>
+inline void stencil_pixel(const unsigned char* const* rows, unsigned char* out, int x) {
+	constexpr int channels = Format::channels, radius = Size / 2;
+	unsigned int sums[channels] = {};
+	unroll<Size>([&](auto i) {
+		const unsigned char* in = rows[i] + (x - radius) * channels;
+		unroll<Size * channels>([&](auto k) {
+			sums[k % channels] += in[k];
+		});
+	});
+	unroll<channels>([&](auto c) {
+		out[x * channels + c] = (unsigned char)(sums[c] / (Size * Size));
+	});
+}
+
+//one pixel near the border, averaging only the neighbours inside the image
+template<int Size, class Format>
+inline void border_pixel(const Image<Format>& input, unsigned char* out, int x, int y) {
+	constexpr int channels = Format::channels, radius = Size / 2;
+	unsigned int sums[channels] = {};
+	int i, j, count = 0;
+	int x0 = x > radius ? x - radius : 0, x1 = x + radius < input.width() ? x + radius + 1 : input.width();
+	int y0 = y > radius ? y - radius : 0, y1 = y + radius < input.height() ? y + radius + 1 : input.height();
+	for(i = y0; i < y1; i++)
+		for(j = x0; j < x1; j++){
+			unroll<channels>([&](auto c) {
+				sums[c] += input.row(i)[j * channels + c];
+			});
+			count++;
+		}
+	unroll<channels>([&](auto c) {
+		out[x * channels + c] = (unsigned char)(sums[c] / count);
+	});
+}
+
+}
+
+/**
+ * Size x Size box blur of rows start to end - 1 of an image into another of
+ * the same size. Bands of rows may be blurred on different threads.
+ *
+ * @param  input: Image to read
+ * @param  output: Image to write, which must not be the input
+ * @param  start: First row to write
+ * @param  end: One past the last row to write
+ */
+template<int Size, class Format>
+void box_blur(const Image<Format>& input, Image<Format>& output, int start, int end) noexcept {
+	static_assert(Size == 3 || Size == 5 || Size == 7, "the stencils come in 3x3, 5x5 and 7x7");
+	constexpr int radius = Size / 2;
+	const unsigned char* rows[Size];
+	int x, y, i, width = input.width(), height = input.height();
+	for(y = start; y < end; y++){
+		unsigned char* out = output.row(y);
+		//rows without a full box above and below, and images too narrow for one
+		if(y < radius || y >= height - radius || width < Size){
+			for(x = 0; x < width; x++)
+				detail::border_pixel<Size>(input, out, x, y);
+			continue;
+		}
+		for(i = 0; i < Size; i++)
+			rows[i] = input.row(y - radius + i);
+		for(x = 0; x < radius; x++)
+			detail::border_pixel<Size>(input, out, x, y);
+		for(; x < width - radius; x++)
+			detail::stencil_pixel<Size, Format>(rows, out, x);
+		for(; x < width; x++)
+			detail::border_pixel<Size>(input, out, x, y);
+	}
+}
+
+template<int Size, class Format>
+void box_blur(const Image<Format>& input, Image<Format>& output) noexcept {
+	box_blur<Size>(input, output, 0, input.height());
+}
+
+}
+#endif
@@ -0,0 +1,82 @@
+/**
+* File:   FilterStencilsCheck.cpp
+* Checks the box blur stencil templates against the C box blur, for every
+* stencil size on images from a single pixel up to several cache lines wide.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <cstdio>
+#include <cstring>
+#include "ImageBuffer.hpp"
+#include "FilterStencils.hpp"
+extern "C" {
+#include "BoxBlur.h"
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//GLOBAL VARIABLES
+//widths and heights around every stencil size, where the border and inner paths meet
+static const int sizes[][2] = {
+	{1, 1}, {2, 9}, {6, 6}, {7, 7}, {8, 3}, {33, 17}, {1023, 5}, {640, 480}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//FORWARD DECLARATIONS
+template<int Size, class Format>
+int check_size(int width, int height);
+
+////////////////////////////////////////////////////////////////////////////////
+//MAIN PROGRAM CODE
+int main() {
+	int failed = 0;
+	for(const auto& size : sizes){
+		failed += check_size<3, goodman::Rgb24>(size[0], size[1]);
+		failed += check_size<5, goodman::Rgb24>(size[0], size[1]);
+		failed += check_size<7, goodman::Rgb24>(size[0], size[1]);
+		failed += check_size<3, goodman::Bgr24>(size[0], size[1]);
+		failed += check_size<5, goodman::Bgr24>(size[0], size[1]);
+		failed += check_size<7, goodman::Bgr24>(size[0], size[1]);
+	}
+	printf("%s\n", failed == 0 ? "box_blur<3>, <5> and <7> match box_blur_rows" : "Stencils differ from box_blur_rows");
+	return failed == 0 ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+/**
+ * blur a noisy image with box_blur<Size> and with box_blur_rows at the same
+ * radius, and compare them row by row.
+ *
+ * @param  width: Width of the image in pixels
+ * @param  height: Height of the image in pixels
+ * @return 0 if the images match, 1 if not or if memory ran out
+ */
+template<int Size, class Format>
+int check_size(int width, int height) {
+	int x, y, mismatch = -1;
+	unsigned int noise = (unsigned int)(width * 31 + height);
+	goodman::Image<Format> input(width, height), output(width, height);
+	::Image view = input.view();
+	::Image* expected = image_create(width, height);
+	if(expected == NULL){
+		printf("Not enough memory for a %dx%d image.\n", width, height);
+		return 1;
+	}
+	for(y = 0; y < height; y++)
+		for(x = 0; x < width * Format::channels; x++){
+			noise = noise * 1103515245u + 12345u;
+			input.row(y)[x] = (unsigned char)(noise >> 16);
+		}
+	goodman::box_blur<Size>(input, output);
+	if(box_blur_rows(&view, expected, Size / 2, 0, height) == 0)
+		for(y = 0, mismatch = 0; y < height && mismatch == 0; y++)
+			if(memcmp(output.row(y), image_row(expected, y), (size_t)width * Format::channels) != 0)
+				mismatch = 1;
+	image_destroy(expected);
+	if(mismatch != 0)
+		printf("box_blur<%d> of a %dx%d image differs from box_blur_rows.\n", Size, width, height);
+	return mismatch != 0;
+}
@@ -1,6 +1,6 @@
 /**
 * File:   GoodmanFilters.c
-* Applies a blur box or Swiss cheese filter to BMP images.
+* Applies a blur box, Gaussian blur or Swiss cheese filter to BMP images.
 *
 * Completion time: 12 hours
 *
@@ -14,81 +14,146 @@
 #include <string.h>
 #include <pthread.h>
 #include <unistd.h>
-//UNCOMMENT BELOW LINE IF USING SER334 LIBRARY/OBJECT FOR BMP SUPPORT
+#include <getopt.h>
+#include <time.h>
+#include <errno.h>
 #include "BmpProcessor.h"
+#include "ImageBuffer.h"
+#include "MappedBmp.h"
+#include "FilterJobs.h"
+#include "FilterContext.h"
+#include "Pipeline.h"
+#include "AsyncFileIO.h"
+#include "RunStats.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 //MACRO DEFINITIONS
-#define THREAD_COUNT 4
+#define MAX_RADII 16
+#define DEFAULT_SIGMA 2.0
+//images each queue of the batch pipeline holds between two stages
+#define PIPELINE_DEPTH 2
+//files each of the batch reader and writer keep in flight with -u
+#define IO_DEPTH 8
+#define MAX_LINE 4096
+//what getopt_long returns for --stats and --perf, past every short option character
+#define STATS_OPTION 256
+#define PERF_OPTION 257
 
 ////////////////////////////////////////////////////////////////////////////////
 //DATA STRUCTURES
-typedef struct Stencil {
-    Pixel pixel[3][3];
-}Stencil;
+//where the radii of a multi-radius blur go: with -m and -o a file is mapped for
+//each, otherwise each is rendered into output and written from it with -o
+typedef struct RadiusOutput {
+    FilterContext* filters;
+    FilterSettings* settings;
+    const char* file_name;  //output file name, NULL without -o
+    BMP_Header* bmp_header;
+    DIB_Header* dib_header;
+    Image* output;          //NULL to map a file for each radius
+    MappedBmp* map;         //mapping of the radius being rendered
+    char* radius_name;      //output file of the radius being rendered
+}RadiusOutput;
+
+//one input and output file of a batch, as it passes through the pipeline
+typedef struct BatchItem {
+    char* input_file_name;
+    char* output_file_name;
+    BMP_Header bmp_header;
+    DIB_Header dib_header;
+    Image* input;       //NULL if the input could not be read
+    Image* output;
+    int owns_names;     //the names were copied from a manifest and go with the item
+}BatchItem;
+
+//shared by the stages of a batch, the reader and writer being NULL without -u
+typedef struct BatchContext {
+    FilterContext* filters;
+    FilterSettings settings;
+    BatchItem* items;
+    int count;
+    int next_read;      //first item whose file has not been queued for reading
+    FileIO* reader;
+    FileIO* writer;
+}BatchContext;
 
 ////////////////////////////////////////////////////////////////////////////////
 //GLOBAL VARIABLES
-int height, width;
-Pixel **input_arr, **output_arr, *pixel;
-Stencil* stencil;
+static const struct option long_options[] = {
+    {"stats", optional_argument, NULL, STATS_OPTION},
+    {"perf", no_argument, NULL, PERF_OPTION},
+    {NULL, 0, NULL, 0}
+};
 
 ////////////////////////////////////////////////////////////////////////////////
 //FORWARD DECLARATIONS
-void* blur_runner(void* param);
-void blur_filter(Stencil* stencil, Pixel* pixel, int height, int width, Pixel** input_arr, Pixel** output_arr, int chunk);
-Pixel* blur_pixel(Stencil* stencil, Pixel* pixel, int num_pixels);
-void* cheese_runner(void* param);
-void cheese_filter(int height, int width, Pixel** input_arr, Pixel** output_arr, int chunk);
-void make_circle(int x_center, int y_center, int r, Pixel** pixel_array, int width, int height);
-void draw_pixel(int x, int y, Pixel** pixel_array, int width, int height);
+void write_output(char* file_name, BMP_Header* bmp_header, DIB_Header* dib_header, Image* image,
+                  FilterContext* filters, FilterSettings* settings);
+void write_headers(FILE* file, BMP_Header* bmp_header, DIB_Header* dib_header);
+char* radius_file_name(const char* file_name, int radius);
+Image* open_radius(void* context, int radius);
+int close_radius(void* context, int radius, Image* output);
+BatchItem* add_batch_item(BatchItem** items, int* count, char* input_file_name);
+void free_batch_items(BatchItem* items, int count);
+void read_manifest(char* file_name, BatchItem** items, int* count);
+void read_stage(void* item, void* context);
+void read_bmp(FILE* input_file, BatchItem* batch_item, RunStats* stats);
+void filter_stage(void* item, void* context);
+void write_stage(void* item, void* context);
+FilterContext* start_filters(int thread_count, RunStats* stats);
+void finish_stats(RunStats* stats, double started, int format);
 
 ////////////////////////////////////////////////////////////////////////////////
 //MAIN PROGRAM CODE
 int main(int argc, char* argv[]){
-    int i, opt, length, arg_index = 0, i_flag = 0, o_flag = 0, f_flag = 0;
-    char *input_file_name, *output_file_name, filter_type, **args;
+    int i, opt, length, height, width, arg_index = 0, o_flag = 0, f_flag = 0, m_flag = 0, s_flag = 0, u_flag = 0, thread_count = 0;
+    int stats_format = -1, perf_flag = 0;
+    uint64_t seed = (uint64_t)time(0);
+    double started = stats_now(), pixels;
+    StageTimer timer;
+    int radii[MAX_RADII] = {1}, radius_count = 1, item_count = 0, tint[3] = {50, 50, 0};
+    double sigma = DEFAULT_SIGMA;
+    char *input_file_name = NULL, *output_file_name = NULL, *manifest_file_name = NULL, filter_type, *token;
     BMP_Header* input_bmp_header;
     DIB_Header* input_dib_header;
     BMP_Header* output_bmp_header;
     DIB_Header* output_dib_header;
-    while((opt = getopt(argc, argv, "i:o:f:")) != -1)
+    BatchItem* items = NULL;
+    void** queue_items;
+    FilterSettings settings = {0};
+    BatchContext batch = {0};
+    MappedBmp *input_map = NULL, *output_map = NULL;
+    Image *input_arr = NULL, *output_arr = NULL;
+    FilterContext* filters;
+    RadiusOutput radius_output = {0};
+    RadiusSink sink = {open_radius, close_radius, &radius_output};
+    RunStats* stats = NULL;
+    FILE *input_file, *output_file;
+    while((opt = getopt_long(argc, argv, "i:o:f:t:r:g:T:s:mSM:u", long_options, NULL)) != -1)
         //parse command line arguments
         switch(opt){
             case 'i':
-                if(arg_index != 0){
+                //further -i/-o pairs before the filter type make a batch
+                if(arg_index % 2 != 0 || f_flag == 1){
                     printf("First argument must be for input file. Exiting\n");
                     exit(1);
                 }
-                if(i_flag == 1){
-                    printf("Extra argument for input file: %s. Additional argument discarded.\n", optarg);
-                    arg_index++;
-                    break;
-                }
                 arg_index++;
-                i_flag = 1;
-                input_file_name = optarg;
+                add_batch_item(&items, &item_count, optarg);
                 break;
             case 'o':
-                if(arg_index != 1){
+                if(arg_index % 2 != 1 || f_flag == 1){
                     printf("Second argument must be for output file name. Exiting\n");
                     exit(1);
                 }
-                if(o_flag == 1){
-                    printf("Extra argument for output file name: %s.  Additional argument discarded.\n", optarg);
-                    arg_index++;
-                    break;
-                }
                 arg_index++;
-                o_flag = 1;
-                output_file_name = optarg;
+                items[item_count - 1].output_file_name = optarg;
                 break;
             case 'f':
-                if(arg_index != 2){
+                if(arg_index % 2 != 0 || (arg_index == 0 && manifest_file_name == NULL)){
                     printf("Third argument must be filter type. Exiting\n");
                     exit(1);
                 }
-                if((optarg[0] != 'b' && optarg[0] != 'c') || strlen(optarg) != 1){
+                if((optarg[0] != 'b' && optarg[0] != 'c' && optarg[0] != 'g') || strlen(optarg) != 1){
                     printf("Invalid filter type argument. Exiting\n\n");
                     exit(1);
                 }
@@ -101,6 +166,81 @@ int main(int argc, char* argv[]){
                 f_flag = 1;
                 filter_type = optarg[0];
                 break;
+            case 't':
+                thread_count = atoi(optarg);
+                if(thread_count < 1){
+                    printf("Invalid thread count argument. Exiting\n");
+                    exit(1);
+                }
+                break;
+            case 'r':
+                //one radius, or a comma separated list rendered from a single summed-area table
+                radius_count = 0;
+                for(token = strtok(optarg, ","); token != NULL; token = strtok(NULL, ",")){
+                    if(radius_count == MAX_RADII || (radii[radius_count++] = atoi(token)) < 1){
+                        printf("Invalid blur radius argument. Exiting\n");
+                        exit(1);
+                    }
+                }
+                if(radius_count == 0){
+                    printf("Invalid blur radius argument. Exiting\n");
+                    exit(1);
+                }
+                break;
+            case 'g':
+                sigma = atof(optarg);
+                if(sigma <= 0){
+                    printf("Invalid Gaussian sigma argument. Exiting\n");
+                    exit(1);
+                }
+                break;
+            case 'T':
+                //red, green and blue amounts the cheese filter adds
+                if(sscanf(optarg, "%d,%d,%d", &tint[0], &tint[1], &tint[2]) != 3
+                   || tint[0] < 0 || tint[0] > 255 || tint[1] < 0 || tint[1] > 255 || tint[2] < 0 || tint[2] > 255){
+                    printf("Invalid tint argument. Exiting\n");
+                    exit(1);
+                }
+                break;
+            case 's':
+                //seed of the cheese holes, the same seed giving the same output
+                seed = strtoull(optarg, &token, 0);
+                if(token == optarg || *token != '\0'){
+                    printf("Invalid seed argument. Exiting\n");
+                    exit(1);
+                }
+                break;
+            case 'm':
+                //filter straight from a mapped input file into a mapped output file
+                m_flag = 1;
+                break;
+            case 'S':
+                //blur band by band, holding only the scanlines the box reaches
+                s_flag = 1;
+                break;
+            case 'M':
+                //a file of input and output names, one pair per line
+                manifest_file_name = optarg;
+                break;
+            case 'u':
+                //batch file I/O through io_uring, where it was built in
+                u_flag = 1;
+                break;
+            case STATS_OPTION:
+                //--stats prints a table of stage and worker timings, --stats=json one JSON object
+                if(optarg == NULL)
+                    stats_format = 0;
+                else if(strcmp(optarg, "json") == 0)
+                    stats_format = 1;
+                else {
+                    printf("Invalid stats format: %s. Exiting\n", optarg);
+                    exit(1);
+                }
+                break;
+            case PERF_OPTION:
+                //hardware event counts alongside the timings, as a table unless --stats=json
+                perf_flag = 1;
+                break;
             case ':':
                 printf("Option needs a value.\n");
                 break;
@@ -108,6 +248,82 @@ int main(int argc, char* argv[]){
                 printf("Unknown option: %c.\n", optopt);
                 break;
         }
+    if(manifest_file_name != NULL)
+        read_manifest(manifest_file_name, &items, &item_count);
+    if(f_flag == 0){
+        printf("No filter type provided. Exiting.\n");
+        exit(1);
+    }
+    settings.filter_type = filter_type;
+    settings.radius = radii[0];
+    settings.sigma = sigma;
+    for(i = 0; i < 3; i++)
+        settings.tint[i] = (unsigned char)tint[i];
+    settings.seed = seed;
+    if(perf_flag == 1 && stats_format < 0)
+        stats_format = 0;
+    if(stats_format >= 0 && (stats = stats_create()) == NULL){
+        printf("Not enough memory for timings. Exiting.\n");
+        exit(1);
+    }
+    //without access to the counters the run goes on, measuring time only
+    if(perf_flag == 1 && stats_count_events(stats) != 0)
+        fprintf(stderr, "Hardware counters are not available (%s). Reporting timings only.\n", strerror(errno));
+    settings.stats = stats;
+    if(item_count > 1 || u_flag == 1){
+        //read the next image and write the last one while this one is filtered
+        if(m_flag == 1 || s_flag == 1 || radius_count > 1){
+            printf("Batches cannot be mapped, streamed or blurred with several radii. Exiting.\n");
+            exit(1);
+        }
+        for(i = 0; i < item_count; i++)
+            if(items[i].output_file_name == NULL){
+                printf("Input file %s has no output file name. Exiting.\n", items[i].input_file_name);
+                exit(1);
+            }
+        batch.filters = start_filters(thread_count, stats);
+        if(batch.filters == NULL){
+            printf("Could not start worker threads. Exiting.\n");
+            exit(1);
+        }
+        batch.settings = settings;
+        batch.items = items;
+        batch.count = item_count;
+        if(u_flag == 1){
+            batch.reader = file_io_create(IO_DEPTH);
+            batch.writer = file_io_create(IO_DEPTH);
+            if(batch.reader == NULL || batch.writer == NULL){
+                printf("Not enough memory for file I/O queues. Exiting.\n");
+                exit(1);
+            }
+            printf("File I/O: %s\n", file_io_backend(batch.reader));
+        }
+        queue_items = (void**)malloc(item_count * sizeof(void*));
+        for(i = 0; i < item_count && queue_items != NULL; i++)
+            queue_items[i] = &items[i];
+        if(queue_items == NULL || pipeline_run(queue_items, item_count, read_stage, filter_stage, write_stage, &batch, PIPELINE_DEPTH) != 0){
+            printf("Could not start the batch pipeline. Exiting.\n");
+            exit(1);
+        }
+        if(batch.writer != NULL && (i = file_io_flush(batch.writer)) > 0)
+            printf("%d output files could not be written.\n", i);
+        file_io_destroy(batch.reader);
+        file_io_destroy(batch.writer);
+        filter_context_destroy(batch.filters);
+        free(queue_items);
+        free_batch_items(items, item_count);
+        finish_stats(stats, started, stats_format);
+        return 0;
+    }
+    if(item_count == 1){
+        input_file_name = items[0].input_file_name;
+        output_file_name = items[0].output_file_name;
+        o_flag = output_file_name != NULL;
+    }
+    if(s_flag == 1 && (o_flag == 0 || m_flag == 1 || filter_type != 'b' || radius_count > 1)){
+        printf("Streaming needs an output file, the box blur and a single radius, without -m. Exiting.\n");
+        exit(1);
+    }
     //verify input file is valid
     if(input_file_name != NULL){
         length = strlen(input_file_name);
@@ -116,25 +332,65 @@ int main(int argc, char* argv[]){
            && (strcmp(&input_file_name[length - 4], ".bmp") == 0)
            && (access(input_file_name, F_OK) != -1)){
             printf("Input: %s\n", input_file_name);
-            FILE* input_file = fopen(input_file_name, "rb");
+            stats_begin(stats, &timer);
+            input_file = fopen(input_file_name, "rb");
             //read a bmp header from file
             input_bmp_header = (BMP_Header*)malloc(sizeof(BMP_Header));
             readBMPHeader(input_file, input_bmp_header);
             //read a dib header from file
             input_dib_header = (DIB_Header*)malloc(sizeof(DIB_Header));
             readDIBHeader(input_file, input_dib_header);
-            //read a bmp pixel array from file
-            fseek(input_file, input_bmp_header->offset_pixel_array, SEEK_SET);
-            input_arr = (Pixel**)malloc(input_dib_header->width * sizeof(Pixel*));
-            for(i = 0; i < input_dib_header->width; i++){
-                input_arr[i] = (Pixel*) malloc(input_dib_header->height * sizeof(Pixel));
+            if(input_bmp_header->signature[0] != 'B' || input_bmp_header->signature[1] != 'M'
+               || input_dib_header->bitsPerPixel != 24 || input_dib_header->compression != 0){
+                printf("Only uncompressed 24-bit BMP files are supported. Exiting.\n");
+                exit(1);
+            }
+            pixels = (double)input_dib_header->width * abs(input_dib_header->height);
+            stats_end(stats, &timer, "header parse", NULL, pixels);
+            //with -S the pixels load during the stream blur, which is timed on its own
+            if(s_flag == 0)
+                stats_begin(stats, &timer);
+            if(s_flag == 1)
+                //the scanlines are read while filtering
+                fseek(input_file, input_bmp_header->offset_pixel_array, SEEK_SET);
+            else if(m_flag == 1){
+                input_map = mapped_bmp_open(input_file, input_bmp_header, input_dib_header);
+                if(input_map == NULL){
+                    printf("Input file could not be mapped. Exiting.\n");
+                    exit(1);
+                }
+                input_arr = input_map->image;
+                //results go straight into the output file, several radii each map their own file later
+                if(o_flag == 0)
+                    output_arr = image_create(input_dib_header->width, abs(input_dib_header->height));
+                else if(filter_type != 'b' || radius_count == 1){
+                    output_map = mapped_bmp_create(output_file_name, input_bmp_header, input_dib_header);
+                    if(output_map == NULL){
+                        printf("Output file %s could not be mapped. Exiting.\n", output_file_name);
+                        exit(1);
+                    }
+                    output_arr = output_map->image;
+                }
+                if(o_flag == 0 && output_arr == NULL){
+                    printf("Not enough memory for a %dx%d image. Exiting.\n", input_dib_header->width, abs(input_dib_header->height));
+                    exit(1);
+                }
             }
-            output_arr = (Pixel**)malloc(input_dib_header->width * sizeof(Pixel*));
-            for(i = 0; i < input_dib_header->width; i++){
-                output_arr[i] = (Pixel*) malloc(input_dib_header->height * sizeof(Pixel));
+            else {
+                //read a bmp pixel array from file, a negative height meaning it is stored top-down
+                fseek(input_file, input_bmp_header->offset_pixel_array, SEEK_SET);
+                input_arr = image_create(input_dib_header->width, abs(input_dib_header->height));
+                output_arr = image_create(input_dib_header->width, abs(input_dib_header->height));
+                if(input_arr == NULL || output_arr == NULL){
+                    printf("Not enough memory for a %dx%d image. Exiting.\n", input_dib_header->width, abs(input_dib_header->height));
+                    exit(1);
+                }
+                readPixelsBMP(input_file, input_arr->rows, input_dib_header->width, input_dib_header->height);
+            }
+            if(s_flag == 0){
+                fclose(input_file);
+                stats_end(stats, &timer, "pixel load", NULL, pixels);
             }
-            readPixelsBMP(input_file, input_arr, input_dib_header->width, input_dib_header->height);
-            fclose(input_file);
         }
         else {
             printf("Input file has an invalid name or is not accessible. Exiting.\n");
@@ -145,415 +401,310 @@ int main(int argc, char* argv[]){
         printf("No input file name provided. Exiting.\n");
         exit(1);
     }
-    height = input_dib_header->height;
+    height = abs(input_dib_header->height);
     width = input_dib_header->width;
-    if(filter_type == 'b')
-        //create blur box threads
-        for(i = 0; i < THREAD_COUNT; i++) {
-            pthread_t tid;
-            pthread_attr_t attr;
-            pthread_attr_init(&attr);
-            pthread_create(&tid, &attr, blur_runner, &i);
-            pthread_join(tid, NULL);
-        }
-    else {
-        //create Swiss cheese threads
-        for (i = 0; i < THREAD_COUNT; i++) {
-            pthread_t tid;
-            pthread_attr_t attr;
-            pthread_attr_init(&attr);
-            pthread_create(&tid, &attr, cheese_runner, &i);
-            pthread_join(tid, NULL);
-        }
-        //determine smallest dimension of input
-        int smallest = 0;
-        if(width < height)
-            smallest = width;
-        else smallest = height;
-        //calculate hole data
-        int num_holes = smallest / 10;
-        int average = num_holes;
-        int large = average + average / 2;
-        int small = average - average / 2;
-        srand(time(0));
-        //draw average holes (50% of holes)
-        for(i = 0; i < num_holes / 2; i++) {
-            int x_center = rand() % width;
-            int y_center = rand() % height;
-            int radius = average;
-            make_circle(x_center, y_center, radius, output_arr, width, height);
-        }
-        //draw large holes (25% of holes)
-        for(i = 0; i < num_holes / 4; i++) {
-            int x_center = rand() % width;
-            int y_center = rand() % height;
-            int radius = large;
-            make_circle(x_center, y_center, radius, output_arr, width, height);
+    //the workers live for the whole run and are shared by every filter stage
+    filters = start_filters(thread_count, stats);
+    if(filters == NULL){
+        printf("Could not start worker threads. Exiting.\n");
+        exit(1);
+    }
+    if(s_flag == 1){
+        output_file = fopen(output_file_name, "wb");
+        if(output_file == NULL){
+            printf("Output file %s could not be opened. Exiting.\n", output_file_name);
+            exit(1);
         }
-        //draw small holes (25% of holes)
-        for(i = 0; i < num_holes / 4; i++) {
-            int x_center = rand() % width;
-            int y_center = rand() % height;
-            int radius = small;
-            make_circle(x_center, y_center, radius, output_arr, width, height);
+        write_headers(output_file, input_bmp_header, input_dib_header);
+        if(filter_context_stream_blur(filters, &settings, input_file, output_file, width, height) != 0){
+            if(errno == EIO)
+                printf("Output file %s could not be written. Exiting.\n", output_file_name);
+            else printf("%s. Exiting.\n", errno == EINVAL ? "Blur radius too large to stream" : "Not enough memory to finish filtering");
+            exit(1);
         }
-    }
-    //produce an output file
-    if(o_flag == 1){
-        FILE* output_file = fopen(output_file_name, "wb");
-        writeBMPHeader(output_file, input_bmp_header);
-        writeDIBHeader(output_file, input_dib_header);
-        writePixelsBMP(output_file, output_arr, input_dib_header->width, input_dib_header->height);
+        fclose(input_file);
         fclose(output_file);
-        for(i = 0; i < input_dib_header->width; i++)
-            free(input_arr[i]);
-        free(input_arr);
-        for(i = 0; i < input_dib_header->width; i++)
-            free(output_arr[i]);
-        free(output_arr);
+        printf("Output: %s\n", output_file_name);
+        filter_context_destroy(filters);
         free(input_bmp_header);
         free(input_dib_header);
+        free_batch_items(items, item_count);
+        finish_stats(stats, started, stats_format);
+        return 0;
+    }
+    if(filter_type == 'b' && radius_count > 1){
+        //build the summed-area table once, then render every radius from it
+        radius_output.filters = filters;
+        radius_output.settings = &settings;
+        radius_output.file_name = o_flag == 1 ? output_file_name : NULL;
+        radius_output.bmp_header = input_bmp_header;
+        radius_output.dib_header = input_dib_header;
+        radius_output.output = output_arr;
+        if(filter_context_apply_radii(filters, &settings, input_arr, radii, radius_count, &sink) != 0){
+            printf("Not enough memory to finish filtering. Exiting.\n");
+            exit(1);
+        }
+    }
+    else if(filter_context_apply(filters, &settings, input_arr, output_arr) != 0){
+        printf("Not enough memory to finish filtering. Exiting.\n");
+        exit(1);
+    }
+    //produce an output file, unless the filters already wrote it through a mapping
+    if(output_map != NULL){
+        stats_begin(stats, &timer);
+        mapped_bmp_close(output_map);
+        stats_end(stats, &timer, "output write", NULL, pixels);
         printf("Output: %s\n", output_file_name);
     }
+    else {
+        if(o_flag == 1 && (filter_type != 'b' || radius_count == 1))
+            write_output(output_file_name, input_bmp_header, input_dib_header, output_arr, filters, &settings);
+        image_destroy(output_arr);
+    }
+    filter_context_destroy(filters);
+    if(input_map != NULL)
+        mapped_bmp_close(input_map);
+    else image_destroy(input_arr);
+    free(input_bmp_header);
+    free(input_dib_header);
+    free_batch_items(items, item_count);
+    finish_stats(stats, started, stats_format);
     return 0;
 }
 
-void* blur_runner(void* param){
-    int chunk_number = *(int*)param;
-    blur_filter(stencil, pixel, height, width, input_arr, output_arr, chunk_number);
-    printf("Thread %d complete.\n", chunk_number);
-    pthread_exit(0);
+void write_output(char* file_name, BMP_Header* bmp_header, DIB_Header* dib_header, Image* image,
+                  FilterContext* filters, FilterSettings* settings){
+    FILE* output_file = fopen(file_name, "wb");
+    if(output_file == NULL){
+        printf("Output file %s could not be opened.\n", file_name);
+        return;
+    }
+    write_headers(output_file, bmp_header, dib_header);
+    if(filters == NULL)
+        writePixelsBMP(output_file, image->rows, dib_header->width, dib_header->height);
+    //every worker encodes its own band of scanlines and writes it in place in the file
+    else if(filter_context_write_pixels(filters, settings, output_file, image, dib_header->height) != 0){
+        printf("Output file %s could not be written.\n", file_name);
+        fclose(output_file);
+        return;
+    }
+    fclose(output_file);
+    printf("Output: %s\n", file_name);
 }
 
-void blur_filter(Stencil* stencil, Pixel* pixel, int height, int width, Pixel** input_arr, Pixel** output_arr, int chunk) {
-    int i, j, k, left_offset, right_offset, left_padding = 0, right_padding = 0;
-    int remaining = width % THREAD_COUNT;
-    int chunk_width = width / THREAD_COUNT;
-    left_offset = chunk_width * chunk;
-    if(chunk == 0){
-        right_offset = left_offset + chunk_width;
-        chunk_width += 1;
-        right_padding = 1;
-    }
-    else if(chunk > 0 && chunk < THREAD_COUNT - 1){
-        right_offset = left_offset + chunk_width;
-        chunk_width += + 2;
-        left_padding = -1;
-        right_padding = 1;
+void write_headers(FILE* file, BMP_Header* bmp_header, DIB_Header* dib_header){
+    //only the 40 byte DIB header is written, so the pixels always start right after it
+    BMP_Header header = *bmp_header;
+    makeBMPHeader(&header, dib_header->width, dib_header->height);
+    header.reserved1 = bmp_header->reserved1;
+    header.reserved2 = bmp_header->reserved2;
+    writeBMPHeader(file, &header);
+    writeDIBHeader(file, dib_header);
+}
+
+char* radius_file_name(const char* file_name, int radius){
+    //out.bmp becomes out_r5.bmp, names without the extension just get the suffix
+    int length = strlen(file_name);
+    char* name = (char*)malloc(length + 16);
+    if(length >= 4 && strcmp(&file_name[length - 4], ".bmp") == 0)
+        sprintf(name, "%.*s_r%d.bmp", length - 4, file_name, radius);
+    else sprintf(name, "%s_r%d", file_name, radius);
+    return name;
+}
+
+Image* open_radius(void* context, int radius){
+    RadiusOutput* radius_output = (RadiusOutput*)context;
+    if(radius_output->file_name != NULL)
+        radius_output->radius_name = radius_file_name(radius_output->file_name, radius);
+    if(radius_output->output != NULL)
+        return radius_output->output;
+    radius_output->map = mapped_bmp_create(radius_output->radius_name, radius_output->bmp_header, radius_output->dib_header);
+    if(radius_output->map == NULL){
+        printf("Output file %s could not be mapped. Exiting.\n", radius_output->radius_name);
+        exit(1);
     }
-    else{
-        right_offset = left_offset + chunk_width + remaining;
-        chunk_width += 1;
-        left_padding = -1;
+    return radius_output->map->image;
+}
+
+int close_radius(void* context, int radius, Image* output){
+    RadiusOutput* radius_output = (RadiusOutput*)context;
+    StageTimer timer;
+    if(radius_output->map != NULL){
+        stats_begin(radius_output->settings->stats, &timer);
+        mapped_bmp_close(radius_output->map);
+        stats_end(radius_output->settings->stats, &timer, "output write", NULL, (double)output->width * output->height);
+        radius_output->map = NULL;
+        printf("Output: %s\n", radius_output->radius_name);
     }
-    stencil = (Stencil*)malloc(sizeof(Stencil));
-    pixel = (Pixel*)malloc(sizeof(Pixel));
-    for(i = 0; i < height; i++){
-        for(j = left_offset + left_padding; j < right_offset + right_padding; j++){
-            //if pixel is upper left corner
-            if(i == 0 && j == 0 && chunk == 0){
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[0][k].red = 0;
-                    stencil->pixel[0][k].green = 0;
-                    stencil->pixel[0][k].blue = 0;
-                }
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[k][0].red = 0;
-                    stencil->pixel[k][0].green = 0;
-                    stencil->pixel[k][0].blue = 0;
-                }
-                stencil->pixel[1][1].red = input_arr[i][j].red;
-                stencil->pixel[1][1].green = input_arr[i][j].green;
-                stencil->pixel[1][1].blue = input_arr[i][j].blue;
-                stencil->pixel[1][2].red = input_arr[i][j + 1].red;
-                stencil->pixel[1][2].green = input_arr[i][j + 1].green;
-                stencil->pixel[1][2].blue = input_arr[i][j + 1].blue;
-                stencil->pixel[2][1].red = input_arr[i + 1][j].red;
-                stencil->pixel[2][1].green = input_arr[i + 1][j].green;
-                stencil->pixel[2][1].blue = input_arr[i + 1][j].blue;
-                stencil->pixel[2][2].red = input_arr[i + 1][j + 1].red;
-                stencil->pixel[2][2].green = input_arr[i + 1][j + 1].green;
-                stencil->pixel[2][2].blue = input_arr[i + 1][j + 1].blue;
-                output_arr[0][0] = *blur_pixel(stencil, pixel, 4);
-            }
-            //if pixel is upper right corner
-            if(i == 0 && j == width - 1 && chunk == THREAD_COUNT - 1){
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[0][k].red = 0;
-                    stencil->pixel[0][k].green = 0;
-                    stencil->pixel[0][k].blue = 0;
-                }
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[k][2].red = 0;
-                    stencil->pixel[k][2].green = 0;
-                    stencil->pixel[k][2].blue = 0;
-                }
-                stencil->pixel[1][0].red = input_arr[i][j - 1].red;
-                stencil->pixel[1][0].green = input_arr[i][j - 1].green;
-                stencil->pixel[1][0].blue = input_arr[i][j - 1].blue;
-                stencil->pixel[1][1].red = input_arr[i][j].red;
-                stencil->pixel[1][1].green = input_arr[i][j].green;
-                stencil->pixel[1][1].blue = input_arr[i][j].blue;
-                stencil->pixel[2][0].red = input_arr[i + 1][j - 1].red;
-                stencil->pixel[2][0].green = input_arr[i + 1][j - 1].green;
-                stencil->pixel[2][0].blue = input_arr[i + 1][j - 1].blue;
-                stencil->pixel[2][1].red = input_arr[i + 1][j].red;
-                stencil->pixel[2][1].green = input_arr[i + 1][j].green;
-                stencil->pixel[2][1].blue = input_arr[i + 1][j].blue;
-                output_arr[0][width - 1] = *blur_pixel(stencil, pixel, 4);
-            }
-            //if pixel is bottom left corner
-            if(i == height - 1 && j == 0 && chunk == 0){
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[2][k].red = 0;
-                    stencil->pixel[2][k].green = 0;
-                    stencil->pixel[2][k].blue = 0;
-                }
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[k][0].red = 0;
-                    stencil->pixel[k][0].green = 0;
-                    stencil->pixel[k][0].blue = 0;
-                }
-                stencil->pixel[0][1].red = input_arr[i - 1][j].red;
-                stencil->pixel[0][1].green = input_arr[i - 1][j].green;
-                stencil->pixel[0][1].blue = input_arr[i - 1][j].blue;
-                stencil->pixel[0][2].red = input_arr[i - 1][j + 1].red;
-                stencil->pixel[0][2].green = input_arr[i - 1][j + 1].green;
-                stencil->pixel[0][2].blue = input_arr[i - 1][j + 1].blue;
-                stencil->pixel[1][1].red = input_arr[i][j].red;
-                stencil->pixel[1][1].green = input_arr[i][j].green;
-                stencil->pixel[1][1].blue = input_arr[i][j].blue;
-                stencil->pixel[1][2].red = input_arr[i][j + 1].red;
-                stencil->pixel[1][2].green = input_arr[i][j + 1].green;
-                stencil->pixel[1][2].blue = input_arr[i][j + 1].blue;
-                output_arr[height - 1][0] = *blur_pixel(stencil, pixel, 4);
-            }
-            //if pixel is bottom right corner
-            if(i == height - 1 && j == width - 1 && chunk == THREAD_COUNT - 1){
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[2][k].red = 0;
-                    stencil->pixel[2][k].green = 0;
-                    stencil->pixel[2][k].blue = 0;
-                }
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[k][2].red = 0;
-                    stencil->pixel[k][2].green = 0;
-                    stencil->pixel[k][2].blue = 0;
-                }
-                stencil->pixel[0][0].red = input_arr[i - 1][j - 1].red;
-                stencil->pixel[0][0].green = input_arr[i - 1][j - 1].green;
-                stencil->pixel[0][0].blue = input_arr[i - 1][j - 1].blue;
-                stencil->pixel[0][1].red = input_arr[i - 1][j].red;
-                stencil->pixel[0][1].green = input_arr[i - 1][j].green;
-                stencil->pixel[0][1].blue = input_arr[i - 1][j].blue;
-                stencil->pixel[1][0].red = input_arr[i][j - 1].red;
-                stencil->pixel[1][0].green = input_arr[i][j - 1].green;
-                stencil->pixel[1][0].blue = input_arr[i][j - 1].blue;
-                stencil->pixel[1][1].red = input_arr[i][j].red;
-                stencil->pixel[1][1].green = input_arr[i][j].green;
-                stencil->pixel[1][1].blue = input_arr[i][j].blue;
-                output_arr[height - 1][width - 1] = *blur_pixel(stencil, pixel, 4);
-            }
-            //if pixel is on the left edge
-            if(i != 0 && i != height - 1 && j == 0 && chunk == 0) {
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[k][0].red = 0;
-                    stencil->pixel[k][0].green = 0;
-                    stencil->pixel[k][0].blue = 0;
-                }
-                stencil->pixel[0][1].red = input_arr[i - 1][j].red;
-                stencil->pixel[0][1].green = input_arr[i - 1][j].green;
-                stencil->pixel[0][1].blue = input_arr[i - 1][j].blue;
-                stencil->pixel[0][2].red = input_arr[i - 1][j + 1].red;
-                stencil->pixel[0][2].green = input_arr[i - 1][j + 1].green;
-                stencil->pixel[0][2].blue = input_arr[i - 1][j + 1].blue;
-                stencil->pixel[1][1].red = input_arr[i][j].red;
-                stencil->pixel[1][1].green = input_arr[i][j].green;
-                stencil->pixel[1][1].blue = input_arr[i][j].blue;
-                stencil->pixel[1][2].red = input_arr[i][j + 1].red;
-                stencil->pixel[1][2].green = input_arr[i][j + 1].green;
-                stencil->pixel[1][2].blue = input_arr[i][j + 1].blue;
-                stencil->pixel[2][1].red = input_arr[i + 1][j].red;
-                stencil->pixel[2][1].green = input_arr[i + 1][j].green;
-                stencil->pixel[2][1].blue = input_arr[i + 1][j].blue;
-                stencil->pixel[2][2].red = input_arr[i + 1][j + 1].red;
-                stencil->pixel[2][2].green = input_arr[i + 1][j + 1].green;
-                stencil->pixel[2][2].blue = input_arr[i + 1][j + 1].blue;
-                output_arr[i][0] = *blur_pixel(stencil, pixel, 6);
-            }
-            //if pixel is on the right edge
-            if(i != 0 && i != height - 1 && j == width - 1 && chunk == THREAD_COUNT - 1) {
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[k][2].red = 0;
-                    stencil->pixel[k][2].green = 0;
-                    stencil->pixel[k][2].blue = 0;
-                }
-                stencil->pixel[0][0].red = input_arr[i - 1][j - 1].red;
-                stencil->pixel[0][0].green = input_arr[i - 1][j - 1].green;
-                stencil->pixel[0][0].blue = input_arr[i - 1][j - 1].blue;
-                stencil->pixel[0][1].red = input_arr[i - 1][j].red;
-                stencil->pixel[0][1].green = input_arr[i - 1][j].green;
-                stencil->pixel[0][1].blue = input_arr[i - 1][j].blue;
-                stencil->pixel[1][0].red = input_arr[i][j - 1].red;
-                stencil->pixel[1][0].green = input_arr[i][j - 1].green;
-                stencil->pixel[1][0].blue = input_arr[i][j - 1].blue;
-                stencil->pixel[1][1].red = input_arr[i][j].red;
-                stencil->pixel[1][1].green = input_arr[i][j].green;
-                stencil->pixel[1][1].blue = input_arr[i][j].blue;
-                stencil->pixel[2][0].red = input_arr[i + 1][j - 1].red;
-                stencil->pixel[2][0].green = input_arr[i + 1][j - 1].green;
-                stencil->pixel[2][0].blue = input_arr[i + 1][j - 1].blue;
-                stencil->pixel[2][1].red = input_arr[i + 1][j].red;
-                stencil->pixel[2][1].green = input_arr[i + 1][j].green;
-                stencil->pixel[2][1].blue = input_arr[i + 1][j].blue;
-                output_arr[i][width - 1] = *blur_pixel(stencil, pixel, 6);
-            }
-            //if pixel is on the upper edge
-            if(i == 0 && j != 0 && j != width - 1) {
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[0][k].red = 0;
-                    stencil->pixel[0][k].green = 0;
-                    stencil->pixel[0][k].blue = 0;
-                }
-                stencil->pixel[1][0].red = input_arr[i][j - 1].red;
-                stencil->pixel[1][0].green = input_arr[i][j - 1].green;
-                stencil->pixel[1][0].blue = input_arr[i][j - 1].blue;
-                stencil->pixel[1][1].red = input_arr[i][j].red;
-                stencil->pixel[1][1].green = input_arr[i][j].green;
-                stencil->pixel[1][1].blue = input_arr[i][j].blue;
-                stencil->pixel[1][2].red = input_arr[i][j + 1].red;
-                stencil->pixel[1][2].green = input_arr[i][j + 1].green;
-                stencil->pixel[1][2].blue = input_arr[i][j + 1].blue;
-                stencil->pixel[2][0].red = input_arr[i + 1][j - 1].red;
-                stencil->pixel[2][0].green = input_arr[i + 1][j - 1].green;
-                stencil->pixel[2][0].blue = input_arr[i + 1][j - 1].blue;
-                stencil->pixel[2][1].red = input_arr[i + 1][j].red;
-                stencil->pixel[2][1].green = input_arr[i + 1][j].green;
-                stencil->pixel[2][1].blue = input_arr[i + 1][j].blue;
-                stencil->pixel[2][2].red = input_arr[i + 1][j + 1].red;
-                stencil->pixel[2][2].green = input_arr[i + 1][j + 1].green;
-                stencil->pixel[2][2].blue = input_arr[i + 1][j + 1].blue;
-                output_arr[0][j] = *blur_pixel(stencil, pixel, 6);
-            }
-            //if pixel is on the bottom edge
-            if(i == height - 1 && j != 0 && j != width - 1) {
-                for (k = 0; k < 3; k++) {
-                    stencil->pixel[2][k].red = 0;
-                    stencil->pixel[2][k].green = 0;
-                    stencil->pixel[2][k].blue = 0;
-                }
-                stencil->pixel[0][0].red = input_arr[i - 1][j - 1].red;
-                stencil->pixel[0][0].green = input_arr[i - 1][j - 1].green;
-                stencil->pixel[0][0].blue = input_arr[i - 1][j - 1].blue;
-                stencil->pixel[0][1].red = input_arr[i - 1][j].red;
-                stencil->pixel[0][1].green = input_arr[i - 1][j].green;
-                stencil->pixel[0][1].blue = input_arr[i - 1][j].blue;
-                stencil->pixel[0][2].red = input_arr[i - 1][j + 1].red;
-                stencil->pixel[0][2].green = input_arr[i - 1][j + 1].green;
-                stencil->pixel[0][2].blue = input_arr[i - 1][j + 1].blue;
-                stencil->pixel[1][0].red = input_arr[i][j - 1].red;
-                stencil->pixel[1][0].green = input_arr[i][j - 1].green;
-                stencil->pixel[1][0].blue = input_arr[i][j - 1].blue;
-                stencil->pixel[1][1].red = input_arr[i][j].red;
-                stencil->pixel[1][1].green = input_arr[i][j].green;
-                stencil->pixel[1][1].blue = input_arr[i][j].blue;
-                stencil->pixel[1][2].red = input_arr[i][j + 1].red;
-                stencil->pixel[1][2].green = input_arr[i][j + 1].green;
-                stencil->pixel[1][2].blue = input_arr[i][j + 1].blue;
-                output_arr[height - 1][j] = *blur_pixel(stencil, pixel, 6);
-            }
-            //if pixel is not on the border
-            if(i != 0 && i != height - 1 && j != 0 && j != width - 1) {
-                stencil->pixel[0][0].red = input_arr[i - 1][j - 1].red;
-                stencil->pixel[0][0].green = input_arr[i - 1][j - 1].green;
-                stencil->pixel[0][0].blue = input_arr[i - 1][j - 1].blue;
-                stencil->pixel[0][1].red = input_arr[i - 1][j].red;
-                stencil->pixel[0][1].green = input_arr[i - 1][j].green;
-                stencil->pixel[0][1].blue = input_arr[i - 1][j].blue;
-                stencil->pixel[0][2].red = input_arr[i - 1][j + 1].red;
-                stencil->pixel[0][2].green = input_arr[i - 1][j + 1].green;
-                stencil->pixel[0][2].blue = input_arr[i - 1][j + 1].blue;
-                stencil->pixel[1][0].red = input_arr[i][j - 1].red;
-                stencil->pixel[1][0].green = input_arr[i][j - 1].green;
-                stencil->pixel[1][0].blue = input_arr[i][j - 1].blue;
-                stencil->pixel[1][1].red = input_arr[i][j].red;
-                stencil->pixel[1][1].green = input_arr[i][j].green;
-                stencil->pixel[1][1].blue = input_arr[i][j].blue;
-                stencil->pixel[1][2].red = input_arr[i][j + 1].red;
-                stencil->pixel[1][2].green = input_arr[i][j + 1].green;
-                stencil->pixel[1][2].blue = input_arr[i][j + 1].blue;
-                stencil->pixel[2][0].red = input_arr[i + 1][j - 1].red;
-                stencil->pixel[2][0].green = input_arr[i + 1][j - 1].green;
-                stencil->pixel[2][0].blue = input_arr[i + 1][j - 1].blue;
-                stencil->pixel[2][1].red = input_arr[i + 1][j].red;
-                stencil->pixel[2][1].green = input_arr[i + 1][j].green;
-                stencil->pixel[2][1].blue = input_arr[i + 1][j].blue;
-                stencil->pixel[2][2].red = input_arr[i + 1][j + 1].red;
-                stencil->pixel[2][2].green = input_arr[i + 1][j + 1].green;
-                stencil->pixel[2][2].blue = input_arr[i + 1][j + 1].blue;
-                output_arr[i][j] = *blur_pixel(stencil, pixel, 9);
-            }
+    else if(radius_output->file_name != NULL)
+        write_output(radius_output->radius_name, radius_output->bmp_header, radius_output->dib_header, output,
+                     radius_output->filters, radius_output->settings);
+    free(radius_output->radius_name);
+    radius_output->radius_name = NULL;
+    return 0;
+}
+
+BatchItem* add_batch_item(BatchItem** items, int* count, char* input_file_name){
+    BatchItem* grown;
+    //grow by doubling, the count only ever being a power of two when the array is full
+    if((*count & (*count - 1)) == 0){
+        grown = (BatchItem*)realloc(*items, (*count > 0 ? 2 * *count : 1) * sizeof(BatchItem));
+        if(grown == NULL){
+            printf("Not enough memory for the list of input files. Exiting.\n");
+            exit(1);
         }
+        *items = grown;
     }
-    free(pixel);
-    free(stencil);
+    memset(&(*items)[*count], 0, sizeof(BatchItem));
+    (*items)[*count].input_file_name = input_file_name;
+    return &(*items)[(*count)++];
 }
 
-Pixel* blur_pixel(Stencil* stencil, Pixel* pixel, int num_pixels) {
-    int i, j, red_sum = 0, green_sum = 0, blue_sum = 0;
-    for(i = 0; i < 3; i++)
-        for(j = 0; j < 3; j++){
-            red_sum += stencil->pixel[i][j].red;
-            green_sum += stencil->pixel[i][j].green;
-            blue_sum += stencil->pixel[i][j].blue;
+void free_batch_items(BatchItem* items, int count){
+    int i;
+    for(i = 0; i < count; i++)
+        if(items[i].owns_names){
+            free(items[i].input_file_name);
+            free(items[i].output_file_name);
         }
-    pixel->red = red_sum / num_pixels;
-    pixel->green = green_sum / num_pixels;
-    pixel->blue = blue_sum / num_pixels;
-    return pixel;
+    free(items);
 }
 
-void* cheese_runner(void* param){
-    int chunk_number = *(int*)param;
-    cheese_filter(height, width, input_arr, output_arr, chunk_number);
-    printf("Thread %d complete.\n", chunk_number);
-    pthread_exit(0);
+void read_manifest(char* file_name, BatchItem** items, int* count){
+    char line[MAX_LINE], *input_file_name, *output_file_name;
+    BatchItem* item;
+    FILE* file = fopen(file_name, "r");
+    if(file == NULL){
+        printf("Manifest file %s could not be opened. Exiting.\n", file_name);
+        exit(1);
+    }
+    //each line names an input file and its output file, blank lines and # comments are skipped
+    while(fgets(line, MAX_LINE, file) != NULL){
+        input_file_name = strtok(line, " \t\r\n");
+        if(input_file_name == NULL || input_file_name[0] == '#')
+            continue;
+        output_file_name = strtok(NULL, " \t\r\n");
+        item = add_batch_item(items, count, strdup(input_file_name));
+        item->output_file_name = output_file_name != NULL ? strdup(output_file_name) : NULL;
+        item->owns_names = 1;
+        if(item->input_file_name == NULL || (output_file_name != NULL && item->output_file_name == NULL)){
+            printf("Not enough memory for the list of input files. Exiting.\n");
+            exit(1);
+        }
+    }
+    fclose(file);
 }
 
-void cheese_filter(int height, int width, Pixel** input_arr, Pixel** output_arr, int chunk) {
-    int i, j, left_offset, right_offset;
-    int remaining = width % THREAD_COUNT;
-    int chunk_width = width / THREAD_COUNT;
-    left_offset = chunk_width * chunk;
-    if(chunk != THREAD_COUNT - 1)
-        right_offset = left_offset + chunk_width;
-    else
-        right_offset = left_offset + chunk_width + remaining;
-    //apply yellow tint
-    for(i = 0; i < height; i++)
-        for(j = left_offset; j < right_offset; j++){
-            if(input_arr[i][j].red + 50 > 255)
-                output_arr[i][j].red = 255;
-            else output_arr[i][j].red = input_arr[i][j].red + 50;
-            if(input_arr[i][j].green + 50 > 255)
-                output_arr[i][j].green = 255;
-            else output_arr[i][j].green = input_arr[i][j].green + 50;
-            output_arr[i][j].blue = input_arr[i][j].blue;
-        }
+void read_stage(void* item, void* context){
+    BatchContext* batch = (BatchContext*)context;
+    BatchItem* batch_item = (BatchItem*)item;
+    unsigned char* data = NULL;
+    size_t length;
+    FILE* input_file;
+    if(batch->reader != NULL){
+        //keep the files after this one loading while it is decoded
+        while(batch->next_read < batch->count && file_io_read(batch->reader, batch->items[batch->next_read].input_file_name) == 0)
+            batch->next_read++;
+        data = file_io_take(batch->reader, &length);
+        input_file = data != NULL ? fmemopen(data, length, "rb") : NULL;
+    }
+    else input_file = fopen(batch_item->input_file_name, "rb");
+    if(input_file == NULL)
+        printf("Input file %s is not accessible. Skipped.\n", batch_item->input_file_name);
+    else {
+        read_bmp(input_file, batch_item, batch->settings.stats);
+        fclose(input_file);
+    }
+    free(data);
+}
+
+void read_bmp(FILE* input_file, BatchItem* batch_item, RunStats* stats){
+    double pixels;
+    StageTimer timer;
+    stats_begin(stats, &timer);
+    readBMPHeader(input_file, &batch_item->bmp_header);
+    readDIBHeader(input_file, &batch_item->dib_header);
+    if(batch_item->bmp_header.signature[0] != 'B' || batch_item->bmp_header.signature[1] != 'M'
+       || batch_item->dib_header.bitsPerPixel != 24 || batch_item->dib_header.compression != 0){
+        printf("Input file %s is not an uncompressed 24-bit BMP file. Skipped.\n", batch_item->input_file_name);
+        stats_end(stats, &timer, "header parse", NULL, 0);
+        return;
+    }
+    pixels = (double)batch_item->dib_header.width * abs(batch_item->dib_header.height);
+    stats_end(stats, &timer, "header parse", NULL, pixels);
+    stats_begin(stats, &timer);
+    fseek(input_file, batch_item->bmp_header.offset_pixel_array, SEEK_SET);
+    batch_item->input = image_create(batch_item->dib_header.width, abs(batch_item->dib_header.height));
+    batch_item->output = image_create(batch_item->dib_header.width, abs(batch_item->dib_header.height));
+    if(batch_item->input == NULL || batch_item->output == NULL){
+        printf("Not enough memory for %s. Skipped.\n", batch_item->input_file_name);
+        image_destroy(batch_item->input);
+        image_destroy(batch_item->output);
+        batch_item->input = NULL;
+        stats_end(stats, &timer, "pixel load", NULL, 0);
+        return;
+    }
+    readPixelsBMP(input_file, batch_item->input->rows, batch_item->dib_header.width, batch_item->dib_header.height);
+    stats_end(stats, &timer, "pixel load", NULL, pixels);
+    printf("Input: %s\n", batch_item->input_file_name);
 }
 
-void make_circle(int x_center, int y_center, int r, Pixel** pixel_array, int width, int height) {
-    int y, x;
-    for (y = -r; y <= r; y++)
-        for (x = -r; x <= r; x++)
-            if (x * x + y * y <= r * r)
-                draw_pixel(x_center + x, y_center + y, pixel_array, width, height);
+void filter_stage(void* item, void* context){
+    BatchContext* batch = (BatchContext*)context;
+    BatchItem* batch_item = (BatchItem*)item;
+    if(batch_item->input == NULL || filter_context_apply(batch->filters, &batch->settings, batch_item->input, batch_item->output) == 0)
+        return;
+    //nothing is written for an image that could not be filtered
+    printf("Not enough memory to filter %s. Skipped.\n", batch_item->input_file_name);
+    image_destroy(batch_item->input);
+    image_destroy(batch_item->output);
+    batch_item->input = NULL;
 }
 
-void draw_pixel(int x, int y, Pixel** pixel_array, int width, int height){
-    if(x >= 0 && x < width && y >= 0 && y < height){
-        pixel_array[x][y].red = 0;
-        pixel_array[x][y].green = 0;
-        pixel_array[x][y].blue = 0;
+void write_stage(void* item, void* context){
+    BatchContext* batch = (BatchContext*)context;
+    BatchItem* batch_item = (BatchItem*)item;
+    char* data;
+    size_t length;
+    StageTimer timer;
+    FILE* output_file;
+    if(batch_item->input == NULL)
+        return;
+    stats_begin(batch->settings.stats, &timer);
+    if(batch->writer != NULL){
+        //encode in memory and let the write run on while the next image is encoded
+        output_file = open_memstream(&data, &length);
+        if(output_file == NULL)
+            printf("Output file %s could not be opened.\n", batch_item->output_file_name);
+        else {
+            write_headers(output_file, &batch_item->bmp_header, &batch_item->dib_header);
+            writePixelsBMP(output_file, batch_item->output->rows, batch_item->dib_header.width, batch_item->dib_header.height);
+            fclose(output_file);
+            file_io_write(batch->writer, batch_item->output_file_name, (unsigned char*)data, length);
+            printf("Output: %s\n", batch_item->output_file_name);
+        }
+    }
+    //the pool is busy with the next image, so the writer thread encodes on its own
+    else write_output(batch_item->output_file_name, &batch_item->bmp_header, &batch_item->dib_header, batch_item->output, NULL, NULL);
+    stats_end(batch->settings.stats, &timer, "output write", NULL, (double)batch_item->dib_header.width * abs(batch_item->dib_header.height));
+    image_destroy(batch_item->input);
+    image_destroy(batch_item->output);
+}
+
+FilterContext* start_filters(int thread_count, RunStats* stats){
+    FilterContext* filters = filter_context_create(thread_count);
+    //the workers measure their tasks for the stats, with events only where they can be counted
+    if(filters != NULL && filter_context_measure(filters, stats) != 0){
+        filter_context_destroy(filters);
+        return NULL;
     }
-}
\ No newline at end of file
+    return filters;
+}
+
+void finish_stats(RunStats* stats, double started, int format){
+    //timings go to stderr, so they never mix with the progress messages
+    if(stats == NULL)
+        return;
+    stats_print(stats, stderr, stats_now() - started, format);
+    stats_destroy(stats);
+}
@@ -0,0 +1,203 @@
+/**
+* File:   HoleMask.c
+* Rasterising cheese holes into per-row spans.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <math.h>
+#include "HoleMask.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//MACRO DEFINITIONS
+//step between the counters of consecutive holes, the SplitMix64 increment
+#define GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+//SplitMix64 finaliser: a counter run through it gives independent 64-bit random values
+static uint64_t split_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+int hole_count(int width, int height) {
+    int num_holes = (width < height ? width : height) / 10;
+    //half are average, a quarter large and a quarter small
+    return num_holes / 2 + 2 * (num_holes / 4);
+}
+
+void hole_place(Circle* circles, int first, int last, int width, int height, uint64_t seed) {
+    int i, num_holes = (width < height ? width : height) / 10;
+    int average = num_holes, large = average + average / 2, small = average - average / 2;
+    uint64_t bits;
+    for(i = first; i < last; i++){
+        //the high and low halves scale to a column and row without modulo bias
+        bits = split_mix(seed + (uint64_t)(i + 1) * GOLDEN_GAMMA);
+        circles[i].x = (int)(((bits >> 32) * (uint64_t)width) >> 32);
+        circles[i].y = (int)(((bits & 0xFFFFFFFFULL) * (uint64_t)height) >> 32);
+        if(i < num_holes / 2)
+            circles[i].radius = average;
+        else if(i < num_holes / 2 + num_holes / 4)
+            circles[i].radius = large;
+        else circles[i].radius = small;
+    }
+}
+
+//largest h with h * h <= n, settled on the exact integer answer after the estimate
+static int integer_sqrt(long long n) {
+    long long h = (long long)sqrt((double)n);
+    while(h * h > n)
+        h--;
+    while((h + 1) * (h + 1) <= n)
+        h++;
+    return (int)h;
+}
+
+//append the circle's span to each of its rows in rows y0 to y1 - 1, using the
+//row's fill count as the cursor. The half-width h of the row at distance dy is
+//the largest with h * h + dy * dy <= r * r; it only shrinks as dy grows, so after
+//the first row of the strip it is walked down with an integer midpoint error term
+static void circle_spans(HoleMask* mask, const Circle* circle, int y0, int y1) {
+    int dy, near, far, h, y, side;
+    long long error;    //r * r - dy * dy - h * h, never negative
+    //distances from the centre of the nearest and farthest rows of the strip
+    if(circle->y < y0)
+        near = y0 - circle->y;
+    else if(circle->y >= y1)
+        near = circle->y - (y1 - 1);
+    else near = 0;
+    far = circle->y - y0 > y1 - 1 - circle->y ? circle->y - y0 : y1 - 1 - circle->y;
+    if(far > circle->radius)
+        far = circle->radius;
+    error = (long long)circle->radius * circle->radius - (long long)near * near;
+    h = integer_sqrt(error);
+    error -= (long long)h * h;
+    for(dy = near; dy <= far; dy++){
+        if(dy > near){
+            error -= 2 * dy - 1;
+            while(error < 0){
+                error += 2 * h - 1;
+                h--;
+            }
+        }
+        for(side = 0; side < (dy > 0 ? 2 : 1); side++){
+            y = side ? circle->y - dy : circle->y + dy;
+            if(y < y0 || y >= y1)
+                continue;
+            mask->spans[mask->starts[y] + mask->counts[y]].x0 = circle->x - h > 0 ? circle->x - h : 0;
+            mask->spans[mask->starts[y] + mask->counts[y]++].x1 = circle->x + h + 1 < mask->width ? circle->x + h + 1 : mask->width;
+        }
+    }
+}
+
+//rows of the circle that fall inside the image
+static void circle_rows(const Circle* circle, int height, int* top, int* bottom) {
+    *top = circle->y - circle->radius > 0 ? circle->y - circle->radius : 0;
+    *bottom = circle->y + circle->radius < height - 1 ? circle->y + circle->radius : height - 1;
+}
+
+static int compare_spans(const void* a, const void* b) {
+    return ((const Span*)a)->x0 - ((const Span*)b)->x0;
+}
+
+HoleMask* hole_mask_create(int width, int height, const Circle* circles, int count) {
+    int i, y, top, bottom, running, total;
+    int* fill;
+    HoleMask* mask = (HoleMask*)calloc(1, sizeof(HoleMask));
+    if(mask == NULL)
+        return NULL;
+    mask->width = width;
+    mask->height = height;
+    mask->circles = circles;
+    mask->strips = (height + HOLE_STRIP_ROWS - 1) / HOLE_STRIP_ROWS;
+    mask->starts = (int*)calloc(height + 1, sizeof(int));
+    mask->counts = (int*)calloc(height + 1, sizeof(int));
+    mask->bucket_starts = (int*)calloc(mask->strips + 1, sizeof(int));
+    fill = (int*)calloc(mask->strips + 1, sizeof(int));
+    if(mask->starts == NULL || mask->counts == NULL || mask->bucket_starts == NULL || fill == NULL){
+        free(fill);
+        hole_mask_destroy(mask);
+        return NULL;
+    }
+    //a circle gives one span to each of its rows and sits in each strip they reach:
+    //mark where its rows and strips begin and end, then run the marks into offsets
+    for(i = 0; i < count; i++){
+        circle_rows(&circles[i], height, &top, &bottom);
+        if(top > bottom)
+            continue;
+        mask->counts[top]++;
+        mask->counts[bottom + 1]--;
+        fill[top / HOLE_STRIP_ROWS]++;
+        fill[bottom / HOLE_STRIP_ROWS + 1]--;
+    }
+    for(y = 0, running = 0; y < height; y++){
+        running += mask->counts[y];
+        mask->starts[y + 1] = mask->starts[y] + running;
+        mask->counts[y] = 0;
+    }
+    for(y = 0, running = 0; y < mask->strips; y++){
+        running += fill[y];
+        mask->bucket_starts[y + 1] = mask->bucket_starts[y] + running;
+        fill[y] = mask->bucket_starts[y];
+    }
+    total = mask->starts[height];
+    mask->spans = (Span*)malloc((total > 0 ? total : 1) * sizeof(Span));
+    total = mask->bucket_starts[mask->strips];
+    mask->bucket = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+    if(mask->spans == NULL || mask->bucket == NULL){
+        free(fill);
+        hole_mask_destroy(mask);
+        return NULL;
+    }
+    for(i = 0; i < count; i++){
+        circle_rows(&circles[i], height, &top, &bottom);
+        for(y = top / HOLE_STRIP_ROWS; top <= bottom && y <= bottom / HOLE_STRIP_ROWS; y++)
+            mask->bucket[fill[y]++] = i;
+    }
+    free(fill);
+    return mask;
+}
+
+int hole_mask_strips(const HoleMask* mask) {
+    return mask->strips;
+}
+
+void hole_mask_fill(HoleMask* mask, int strip) {
+    int i, y, kept, n, y0 = strip * HOLE_STRIP_ROWS;
+    int y1 = y0 + HOLE_STRIP_ROWS < mask->height ? y0 + HOLE_STRIP_ROWS : mask->height;
+    Span* row;
+    for(i = mask->bucket_starts[strip]; i < mask->bucket_starts[strip + 1]; i++)
+        circle_spans(mask, &mask->circles[mask->bucket[i]], y0, y1);
+    //sort each row and merge overlapping or touching spans, dropping ones clipped away
+    for(y = y0; y < y1; y++){
+        row = mask->spans + mask->starts[y];
+        n = mask->counts[y];
+        qsort(row, n, sizeof(Span), compare_spans);
+        for(i = 0, kept = -1; i < n; i++){
+            if(row[i].x0 >= row[i].x1)
+                continue;
+            if(kept >= 0 && row[i].x0 <= row[kept].x1){
+                if(row[i].x1 > row[kept].x1)
+                    row[kept].x1 = row[i].x1;
+            }
+            else row[++kept] = row[i];
+        }
+        mask->counts[y] = kept + 1;
+    }
+}
+
+void hole_mask_destroy(HoleMask* mask) {
+    if(mask == NULL)
+        return;
+    free(mask->starts);
+    free(mask->counts);
+    free(mask->spans);
+    free(mask->bucket_starts);
+    free(mask->bucket);
+    free(mask);
+}
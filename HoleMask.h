@@ -0,0 +1,116 @@
+/**
+* The holes of the Swiss cheese filter as black spans per row, so the tint and
+* the holes can be applied in the same pass over the image.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef HoleMask_H
+#define HoleMask_H 1
+#include <stdint.h>
+
+//rows in each strip of the grid the holes are filed under
+#define HOLE_STRIP_ROWS 64
+
+typedef struct Circle {
+	int x;			//column of the centre
+	int y;			//row of the centre
+	int radius;		//pixels with x * x + y * y <= radius * radius are inside
+}Circle;
+
+typedef struct Span {
+	int x0;			//first column of the span
+	int x1;			//one past the last column of the span
+}Span;
+
+typedef struct HoleMask {
+	int width;		//width of the image in pixels
+	int height;		//height of the image in pixels
+	int strips;		//number of strips of HOLE_STRIP_ROWS rows
+	const Circle* circles;	//the holes, which the mask does not own
+	int* bucket_starts;	//strip s holds the holes bucket[bucket_starts[s]] to bucket[bucket_starts[s + 1] - 1]
+	int* bucket;		//indices of the holes reaching each strip
+	int* starts;		//row y has room for spans starts[y] to starts[y + 1] - 1
+	int* counts;		//number of spans row y holds once its strip is filled
+	Span* spans;		//every row's spans, sorted by column and not overlapping
+}HoleMask;
+
+/**
+ * number of holes the cheese filter cuts into an image.
+ *
+ * @param  width: Width of the image in pixels
+ * @param  height: Height of the image in pixels
+ * @return The number of holes
+ */
+int hole_count(int width, int height);
+
+
+/**
+ * lays out holes first to last - 1 of an image. Each hole depends only on the
+ * seed and its own index, so any range can be placed on any thread and the
+ * same seed always gives the same holes.
+ *
+ * @param  circles: Destination for the holes, indexed from the first hole of the image
+ * @param  first: Index of the first hole to place
+ * @param  last: One past the index of the last hole to place
+ * @param  width: Width of the image in pixels
+ * @param  height: Height of the image in pixels
+ * @param  seed: Seed of the layout
+ */
+void hole_place(Circle* circles, int first, int last, int width, int height, uint64_t seed);
+
+
+/**
+ * file circles under the strips of rows they reach and make room for their
+ * spans. The rows stay empty until each strip is filled with hole_mask_fill.
+ *
+ * @param  width: Width of the image in pixels
+ * @param  height: Height of the image in pixels
+ * @param  circles: The holes, which must live until every strip is filled
+ * @param  count: Number of holes
+ * @return The mask, or NULL if memory ran out
+ */
+HoleMask* hole_mask_create(int width, int height, const Circle* circles, int count);
+
+
+/**
+ * number of strips of a mask.
+ *
+ * @param  mask: The mask
+ */
+int hole_mask_strips(const HoleMask* mask);
+
+
+/**
+ * rasterise the holes filed under a strip into spans of its rows, clipped to
+ * the image. Overlapping holes are merged, so every pixel is covered by at most
+ * one span. Different strips can be filled at the same time.
+ *
+ * @param  mask: The mask
+ * @param  strip: Strip number
+ */
+void hole_mask_fill(HoleMask* mask, int strip);
+
+
+/**
+ * release a mask created by hole_mask_create.
+ *
+ * @param  mask: The mask to free, may be NULL
+ */
+void hole_mask_destroy(HoleMask* mask);
+
+
+/**
+ * spans of one row.
+ *
+ * @param  mask: The mask
+ * @param  y: Row number
+ * @param  count: Destination for the number of spans in the row
+ * @return The first span of the row
+ */
+static inline const Span* hole_mask_row(const HoleMask* mask, int y, int* count) {
+	*count = mask->counts[y];
+	return mask->spans + mask->starts[y];
+}
+#endif
@@ -0,0 +1,71 @@
+/**
+* File:   ImageBuffer.c
+* Allocation of contiguous, row-major image buffers.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include "ImageBuffer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+Image* image_create(int width, int height) {
+    int y;
+    size_t size;
+    void* data;
+    Image* image = (Image*)malloc(sizeof(Image));
+    if(image == NULL)
+        return NULL;
+    image->width = width;
+    image->height = height;
+    //round each scanline up so that every row starts on an aligned boundary
+    image->stride = (width * (int)sizeof(Pixel) + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+    size = (size_t)image->stride * height;
+    if(size == 0)
+        size = IMAGE_ALIGNMENT;
+    image->rows = (Pixel**)malloc((height > 0 ? height : 1) * sizeof(Pixel*));
+    if(image->rows == NULL || posix_memalign(&data, IMAGE_ALIGNMENT, size) != 0){
+        free(image->rows);
+        free(image);
+        return NULL;
+    }
+    image->data = (unsigned char*)data;
+    image->blue_first = 0;
+    image->owns_data = 1;
+    for(y = 0; y < height; y++)
+        image->rows[y] = image_row(image, y);
+    return image;
+}
+
+Image* image_wrap(unsigned char* data, int width, int height, int stride, int blue_first) {
+    int y;
+    Image* image = (Image*)malloc(sizeof(Image));
+    if(image == NULL)
+        return NULL;
+    image->width = width;
+    image->height = height;
+    image->stride = stride;
+    image->data = data;
+    image->blue_first = blue_first;
+    image->owns_data = 0;
+    image->rows = (Pixel**)malloc((height > 0 ? height : 1) * sizeof(Pixel*));
+    if(image->rows == NULL){
+        free(image);
+        return NULL;
+    }
+    for(y = 0; y < height; y++)
+        image->rows[y] = image_row(image, y);
+    return image;
+}
+
+void image_destroy(Image* image) {
+    if(image == NULL)
+        return;
+    if(image->owns_data)
+        free(image->data);
+    free(image->rows);
+    free(image);
+}
@@ -0,0 +1,69 @@
+/**
+* A contiguous, row-major image buffer shared by the BMP loader and the filters.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef ImageBuffer_H
+#define ImageBuffer_H 1
+#include <stddef.h>
+#include "PixelProcessor.h"
+#include "FilterExport.h"
+
+//alignment of the pixel buffer and of every row within it, in bytes
+#define IMAGE_ALIGNMENT 64
+
+typedef struct Image {
+	int width;			//width of the image in pixels
+	int height;			//height of the image in pixels
+	int stride;			//bytes between the starts of consecutive rows
+	unsigned char* data;		//first byte of row 0 (the top scanline)
+	Pixel** rows;			//row pointer table into data, for the Pixel** BMP API
+	int blue_first;			//channels are stored blue, green, red as in a BMP file
+	int owns_data;			//data was allocated by image_create rather than borrowed
+}Image;
+
+/**
+ * allocate an image as a single aligned block of height rows, each padded out
+ * to a multiple of IMAGE_ALIGNMENT bytes.
+ *
+ * @param  width: Width of the image in pixels
+ * @param  height: Height of the image in pixels
+ * @return The new image, or NULL if the allocation failed
+ */
+GOODMAN_API Image* image_create(int width, int height);
+
+
+/**
+ * wrap pixels owned by someone else, such as a mapped BMP file, without copying.
+ * A negative stride walks a bottom-up pixel array from its last scanline.
+ *
+ * @param  data: First byte of the top scanline
+ * @param  width: Width of the image in pixels
+ * @param  height: Height of the image in pixels
+ * @param  stride: Bytes from the start of one row to the start of the row below
+ * @param  blue_first: Nonzero if each pixel is stored blue, green, red
+ * @return The new image, or NULL if the allocation failed
+ */
+GOODMAN_API Image* image_wrap(unsigned char* data, int width, int height, int stride, int blue_first);
+
+
+/**
+ * release an image created by image_create or image_wrap.
+ *
+ * @param  image: The image to free, may be NULL
+ */
+GOODMAN_API void image_destroy(Image* image);
+
+
+/**
+ * address of the first pixel of a row.
+ *
+ * @param  image: The image to index
+ * @param  y: Row number, 0 being the top scanline
+ */
+static inline Pixel* image_row(const Image* image, int y) {
+	return (Pixel*)(image->data + (ptrdiff_t)y * image->stride);
+}
+#endif
@@ -0,0 +1,140 @@
+/**
+* A move-only C++ image that owns one aligned pixel buffer laid out like the C
+* Image: rows padded to IMAGE_ALIGNMENT bytes, row 0 the top scanline. The
+* pixel format is a template parameter, so images of different formats cannot
+* be mixed up.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef ImageBuffer_HPP
+#define ImageBuffer_HPP 1
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+extern "C" {
+#include "ImageBuffer.h"
+}
+
+namespace goodman {
+
+//pixel formats: bytes per pixel, and whether red comes first as in Pixel or blue
+//first as in a BMP file
+struct Rgb24 {
+	static constexpr int channels = 3;
+	static constexpr bool blue_first = false;
+};
+
+struct Bgr24 {
+	static constexpr int channels = 3;
+	static constexpr bool blue_first = true;
+};
+
+struct Bgra32 {
+	static constexpr int channels = 4;
+	static constexpr bool blue_first = true;
+};
+
+struct Gray8 {
+	static constexpr int channels = 1;
+	static constexpr bool blue_first = false;
+};
+
+template<class Format = Rgb24>
+class Image {
+public:
+	using format = Format;
+
+	//an empty image, owning nothing, for moving another into
+	Image() noexcept = default;
+
+	/**
+	 * allocate an image of width x height pixels, left uninitialised.
+	 *
+	 * @param  width: Width of the image in pixels
+	 * @param  height: Height of the image in pixels
+	 * @throws std::bad_alloc if the buffer could not be allocated
+	 */
+	Image(int width, int height)
+		: width_(width), height_(height),
+		  stride_((width * Format::channels + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT) {
+		void* data;
+		std::size_t size = (std::size_t)stride_ * height;
+		if(width < 0 || height < 0 || posix_memalign(&data, IMAGE_ALIGNMENT, size > 0 ? size : IMAGE_ALIGNMENT) != 0)
+			throw std::bad_alloc();
+		data_ = static_cast<unsigned char*>(data);
+	}
+
+	//buffers are never copied, only handed on
+	Image(const Image&) = delete;
+	Image& operator=(const Image&) = delete;
+
+	Image(Image&& other) noexcept
+		: width_(std::exchange(other.width_, 0)), height_(std::exchange(other.height_, 0)),
+		  stride_(std::exchange(other.stride_, 0)), data_(std::exchange(other.data_, nullptr)) {
+	}
+
+	Image& operator=(Image&& other) noexcept {
+		if(this != &other){
+			std::free(data_);
+			width_ = std::exchange(other.width_, 0);
+			height_ = std::exchange(other.height_, 0);
+			stride_ = std::exchange(other.stride_, 0);
+			data_ = std::exchange(other.data_, nullptr);
+		}
+		return *this;
+	}
+
+	~Image() {
+		std::free(data_);
+	}
+
+	int width() const noexcept { return width_; }
+	int height() const noexcept { return height_; }
+	int stride() const noexcept { return stride_; }
+	unsigned char* data() noexcept { return data_; }
+	const unsigned char* data() const noexcept { return data_; }
+	explicit operator bool() const noexcept { return data_ != nullptr; }
+
+	/**
+	 * address of the first byte of a row.
+	 *
+	 * @param  y: Row number, 0 being the top scanline
+	 */
+	unsigned char* row(int y) noexcept {
+		return data_ + (std::ptrdiff_t)y * stride_;
+	}
+
+	const unsigned char* row(int y) const noexcept {
+		return data_ + (std::ptrdiff_t)y * stride_;
+	}
+
+	/**
+	 * the pixels as a C Image for the C filters, which index rows through
+	 * image_row. The view has no row pointer table, so it is not for the
+	 * Pixel** BMP functions, and it is valid while this image owns the buffer.
+	 */
+	::Image view() noexcept {
+		static_assert(Format::channels == (int)sizeof(Pixel), "the C filters work on 3-byte pixels");
+		::Image image;
+		image.width = width_;
+		image.height = height_;
+		image.stride = stride_;
+		image.data = data_;
+		image.rows = nullptr;
+		image.blue_first = Format::blue_first;
+		image.owns_data = 0;
+		return image;
+	}
+
+private:
+	int width_ = 0;			//width of the image in pixels
+	int height_ = 0;		//height of the image in pixels
+	int stride_ = 0;		//bytes between the starts of consecutive rows
+	unsigned char* data_ = nullptr;	//first byte of row 0, from posix_memalign
+};
+
+}
+#endif
@@ -0,0 +1,86 @@
+/**
+* File:   MappedBmp.c
+* Memory mapping of BMP input and output files.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "MappedBmp.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//FORWARD DECLARATIONS
+static MappedBmp* map_file(int fd, size_t length, int writable, long offset, int width, int height);
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+MappedBmp* mapped_bmp_open(FILE* file, struct BMP_Header* bmp_header, struct DIB_Header* dib_header) {
+    struct stat status;
+    int row_size = (dib_header->width * 3 + 3) & ~3;
+    if(fstat(fileno(file), &status) != 0 || bmp_header->offset_pixel_array < 0
+       || (size_t)status.st_size < (size_t)bmp_header->offset_pixel_array + (size_t)row_size * abs(dib_header->height))
+        return NULL;
+    return map_file(fileno(file), (size_t)status.st_size, 0, bmp_header->offset_pixel_array, dib_header->width, dib_header->height);
+}
+
+MappedBmp* mapped_bmp_create(const char* file_name, struct BMP_Header* bmp_header, struct DIB_Header* dib_header) {
+    BMP_Header header = *bmp_header;
+    MappedBmp* map;
+    FILE* file = fopen(file_name, "wb+");
+    if(file == NULL)
+        return NULL;
+    //the file is sized up front so that the mapping covers every pixel
+    makeBMPHeader(&header, dib_header->width, dib_header->height);
+    header.reserved1 = bmp_header->reserved1;
+    header.reserved2 = bmp_header->reserved2;
+    writeBMPHeader(file, &header);
+    writeDIBHeader(file, dib_header);
+    if(fflush(file) != 0 || ftruncate(fileno(file), header.size) != 0){
+        fclose(file);
+        return NULL;
+    }
+    map = map_file(fileno(file), (size_t)header.size, 1, header.offset_pixel_array, dib_header->width, dib_header->height);
+    fclose(file);
+    return map;
+}
+
+void mapped_bmp_close(MappedBmp* map) {
+    if(map == NULL)
+        return;
+    image_destroy(map->image);
+    munmap(map->base, map->length);
+    free(map);
+}
+
+static MappedBmp* map_file(int fd, size_t length, int writable, long offset, int width, int height) {
+    int row_size = (width * 3 + 3) & ~3, rows = abs(height);
+    unsigned char* pixels;
+    MappedBmp* map = (MappedBmp*)malloc(sizeof(MappedBmp));
+    if(map == NULL)
+        return NULL;
+    map->length = length;
+    map->base = mmap(NULL, length, writable ? PROT_READ | PROT_WRITE : PROT_READ, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    if(map->base == MAP_FAILED){
+        free(map);
+        return NULL;
+    }
+    //the filters walk rows in order, which the kernel can read ahead for
+    madvise(map->base, length, MADV_SEQUENTIAL);
+    pixels = (unsigned char*)map->base + offset;
+    //a positive height stores the bottom scanline first, so walk up from the last one
+    if(height > 0)
+        map->image = image_wrap(pixels + (size_t)(rows - 1) * row_size, width, rows, -row_size, 1);
+    else map->image = image_wrap(pixels, width, rows, row_size, 1);
+    if(map->image == NULL){
+        munmap(map->base, length);
+        free(map);
+        return NULL;
+    }
+    return map;
+}
@@ -0,0 +1,53 @@
+/**
+* Memory-mapped BMP files, so the filters can read an input file and write an
+* output file in place instead of through heap copies.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef MappedBmp_H
+#define MappedBmp_H 1
+#include <stdio.h>
+#include <stddef.h>
+#include "BmpProcessor.h"
+#include "ImageBuffer.h"
+#include "FilterExport.h"
+
+typedef struct MappedBmp {
+	void* base;			//start of the mapping, the BMP header
+	size_t length;			//bytes mapped, the whole file
+	Image* image;			//view of the pixel array, in file (blue, green, red) order
+}MappedBmp;
+
+/**
+ * map the pixel array of an open BMP file read-only. The file can be closed
+ * afterwards; the mapping stays valid until mapped_bmp_close.
+ *
+ * @param  file: The BMP file, opened for reading
+ * @param  bmp_header: Its BMP header, already read
+ * @param  dib_header: Its DIB header, already read
+ * @return The mapping, or NULL if the file is too short or cannot be mapped
+ */
+GOODMAN_API MappedBmp* mapped_bmp_open(FILE* file, struct BMP_Header* bmp_header, struct DIB_Header* dib_header);
+
+
+/**
+ * create a BMP file at its final size, write its headers and map it shared,
+ * so that pixels stored into the image land in the file.
+ *
+ * @param  file_name: Name of the file to create or replace
+ * @param  bmp_header: BMP header to write, the size and pixel offset are recomputed
+ * @param  dib_header: DIB header to write, giving the width and height
+ * @return The mapping, or NULL if the file cannot be created or mapped
+ */
+GOODMAN_API MappedBmp* mapped_bmp_create(const char* file_name, struct BMP_Header* bmp_header, struct DIB_Header* dib_header);
+
+
+/**
+ * unmap a file mapped by mapped_bmp_open or mapped_bmp_create.
+ *
+ * @param  map: The mapping to release, may be NULL
+ */
+GOODMAN_API void mapped_bmp_close(MappedBmp* map);
+#endif
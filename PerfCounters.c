@@ -0,0 +1,72 @@
+/**
+* File:   PerfCounters.c
+* Per-thread hardware event counting with perf_event_open.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "PerfCounters.h"
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+int perf_counters_open(PerfCounters* counters) {
+    int i, opened = 0;
+#ifdef __linux__
+    struct perf_event_attr attr;
+    //generic events, so the same build runs on any cpu the kernel knows
+    static const uint64_t configs[PERF_EVENTS][2] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+    };
+    int error = 0;
+    for(i = 0; i < PERF_EVENTS; i++){
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = (uint32_t)configs[i][0];
+        attr.config = configs[i][1];
+        //only the filter's own code, which is also all an unprivileged user may count
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        counters->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if(counters->fds[i] >= 0)
+            opened |= 1 << i;
+        else error = errno;
+    }
+    if(opened == 0)
+        errno = error;
+#else
+    for(i = 0; i < PERF_EVENTS; i++)
+        counters->fds[i] = -1;
+    errno = ENOSYS;
+#endif
+    counters->ready = 1;
+    return opened;
+}
+
+void perf_counters_read(const PerfCounters* counters, uint64_t* counts) {
+    int i;
+    for(i = 0; i < PERF_EVENTS; i++)
+        if(counters->fds[i] < 0 || read(counters->fds[i], &counts[i], sizeof(uint64_t)) != sizeof(uint64_t))
+            counts[i] = 0;
+}
+
+void perf_counters_close(PerfCounters* counters) {
+    int i;
+    if(!counters->ready)
+        return;
+    for(i = 0; i < PERF_EVENTS; i++)
+        if(counters->fds[i] >= 0)
+            close(counters->fds[i]);
+    counters->ready = 0;
+}
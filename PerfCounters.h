@@ -0,0 +1,53 @@
+/**
+* Hardware performance counters of one thread through perf_event_open, for
+* telling how well a filter uses the cpu: instructions per cycle, cache misses
+* and branch mispredictions.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef PerfCounters_H
+#define PerfCounters_H 1
+#include <stdint.h>
+
+//the counted events, indexing every array of counts
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_LLC_MISSES 2
+#define PERF_BRANCH_MISSES 3
+#define PERF_EVENTS 4
+
+typedef struct PerfCounters {
+	int ready;		//set once the counters have been opened, whether or not that worked
+	int fds[PERF_EVENTS];	//one per event, -1 for an event that could not be opened
+}PerfCounters;
+
+/**
+ * start counting the user-space events of the calling thread. Events the
+ * kernel or the cpu does not allow are left out, and read as 0.
+ *
+ * @param  counters: The counters to open
+ * @return A bit for every event that was opened (1 << PERF_CYCLES and so on),
+ *         0 if none was, with errno telling why the last one failed
+ */
+int perf_counters_open(PerfCounters* counters);
+
+
+/**
+ * counts since the counters were opened.
+ *
+ * @param  counters: The counters
+ * @param  counts: Destination for PERF_EVENTS counts
+ */
+void perf_counters_read(const PerfCounters* counters, uint64_t* counts);
+
+
+/**
+ * stop counting and release the counters. Counters that were never opened are
+ * left alone.
+ *
+ * @param  counters: The counters
+ */
+void perf_counters_close(PerfCounters* counters);
+#endif
@@ -0,0 +1,120 @@
+/**
+* File:   Pipeline.c
+* Read, filter and write stages connected by bounded queues.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include "Pipeline.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//DATA STRUCTURES
+//what the read and write threads need, the end of the items being marked by NULL
+typedef struct Stage {
+    void** items;
+    int count;
+    StageFunction function;
+    void* context;
+    StageQueue* input;     //queue the stage takes items from, NULL for the first stage
+    StageQueue* output;    //queue the stage passes items to, NULL for the last stage
+}Stage;
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+static int queue_init(StageQueue* queue, int capacity) {
+    queue->items = (void**)malloc(capacity * sizeof(void*));
+    if(queue->items == NULL)
+        return -1;
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    return 0;
+}
+
+static void queue_destroy(StageQueue* queue) {
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    free(queue->items);
+}
+
+static void queue_push(StageQueue* queue, void* item) {
+    pthread_mutex_lock(&queue->lock);
+    while(queue->count == queue->capacity)
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    queue->items[(queue->head + queue->count++) % queue->capacity] = item;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void* queue_pop(StageQueue* queue) {
+    void* item;
+    pthread_mutex_lock(&queue->lock);
+    while(queue->count == 0)
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    item = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return item;
+}
+
+//runs one stage: the first stage walks the array, later ones drain their input queue
+static void run_stage(Stage* stage) {
+    int i;
+    void* item;
+    for(i = 0; stage->input != NULL || i < stage->count; i++){
+        item = stage->input != NULL ? queue_pop(stage->input) : stage->items[i];
+        if(item == NULL)
+            break;
+        stage->function(item, stage->context);
+        if(stage->output != NULL)
+            queue_push(stage->output, item);
+    }
+    //let the next stage know there is nothing more to come
+    if(stage->output != NULL)
+        queue_push(stage->output, NULL);
+}
+
+static void* stage_main(void* param) {
+    run_stage((Stage*)param);
+    return NULL;
+}
+
+int pipeline_run(void** items, int count, StageFunction read, StageFunction filter, StageFunction write, void* context, int depth) {
+    StageQueue read_queue, write_queue;
+    pthread_t reader, writer;
+    Stage read_stage = {items, count, read, context, NULL, &read_queue};
+    Stage filter_stage = {items, count, filter, context, &read_queue, &write_queue};
+    Stage write_stage = {items, count, write, context, &write_queue, NULL};
+    int result = -1;
+    if(queue_init(&read_queue, depth) != 0)
+        return -1;
+    if(queue_init(&write_queue, depth) != 0){
+        queue_destroy(&read_queue);
+        return -1;
+    }
+    if(pthread_create(&reader, NULL, stage_main, &read_stage) == 0){
+        if(pthread_create(&writer, NULL, stage_main, &write_stage) == 0){
+            run_stage(&filter_stage);
+            pthread_join(writer, NULL);
+            result = 0;
+        }
+        else {
+            //without a writer, drain the items here so the reader can finish
+            while(queue_pop(&read_queue) != NULL)
+                ;
+        }
+        pthread_join(reader, NULL);
+    }
+    queue_destroy(&read_queue);
+    queue_destroy(&write_queue);
+    return result;
+}
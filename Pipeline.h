@@ -0,0 +1,48 @@
+/**
+* A three stage read, filter and write pipeline, so that while one image is
+* being filtered the next is being read and the previous one written.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef Pipeline_H
+#define Pipeline_H 1
+#include <pthread.h>
+
+/**
+ * one stage of the pipeline, applied to every item in order.
+ *
+ * @param  item: The item passing through the stage
+ * @param  context: Pointer given to pipeline_run, shared by every stage
+ */
+typedef void (*StageFunction)(void* item, void* context);
+
+//A bounded queue of items handed from one stage to the next. The producer waits
+//while it is full, so a slow stage holds back the ones before it.
+typedef struct StageQueue {
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;	//signalled when an item is added
+	pthread_cond_t not_full;	//signalled when an item is removed
+	void** items;			//ring of waiting items
+	int capacity;			//length of items
+	int head;			//index of the oldest waiting item
+	int count;			//number of waiting items
+}StageQueue;
+
+/**
+ * run every item through the read, filter and write stages. The read and write
+ * stages each get a thread of their own and the filter stage runs on the calling
+ * thread, so it can use a thread pool. Stages see the items in array order.
+ *
+ * @param  items: The items to process
+ * @param  count: Number of items
+ * @param  read: First stage, such as loading an image
+ * @param  filter: Second stage
+ * @param  write: Last stage, such as saving and freeing an image
+ * @param  context: Argument passed to every stage
+ * @param  depth: Items each queue between two stages can hold, at least 1
+ * @return 0 on success, -1 if the stage threads could not be started
+ */
+int pipeline_run(void** items, int count, StageFunction read, StageFunction filter, StageFunction write, void* context, int depth);
+#endif
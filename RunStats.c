@@ -0,0 +1,234 @@
+/**
+* File:   RunStats.c
+* Collecting and printing stage and worker timings.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include "RunStats.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+RunStats* stats_create(void) {
+    RunStats* stats = (RunStats*)calloc(1, sizeof(RunStats));
+    if(stats == NULL)
+        return NULL;
+    pthread_mutex_init(&stats->lock, NULL);
+    return stats;
+}
+
+void stats_destroy(RunStats* stats) {
+    int i;
+    if(stats == NULL)
+        return;
+    for(i = 0; i < stats->count; i++){
+        free(stats->stages[i].busy);
+        free(stats->stages[i].worker_events);
+    }
+    pthread_mutex_destroy(&stats->lock);
+    free(stats);
+}
+
+double stats_now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+int stats_count_events(RunStats* stats) {
+    PerfCounters counters;
+    int error;
+    //a trial open on this thread tells whether the workers will manage too
+    stats->events = perf_counters_open(&counters);
+    error = errno;
+    perf_counters_close(&counters);
+    errno = error;
+    return stats->events != 0 ? 0 : -1;
+}
+
+void stats_begin(RunStats* stats, StageTimer* timer) {
+    if(stats == NULL)
+        return;
+    timer->counters.ready = 0;
+    if(stats->events != 0)
+        perf_counters_open(&timer->counters);
+    timer->start = stats_now();
+}
+
+void stats_end(RunStats* stats, StageTimer* timer, const char* name, ThreadPool* pool, double pixels) {
+    int i, j;
+    double seconds;
+    uint64_t counts[PERF_EVENTS] = {0};
+    StageStats* stage = NULL;
+    if(stats == NULL)
+        return;
+    seconds = stats_now() - timer->start;
+    if(timer->counters.ready){
+        perf_counters_read(&timer->counters, counts);
+        perf_counters_close(&timer->counters);
+    }
+    pthread_mutex_lock(&stats->lock);
+    for(i = 0; i < stats->count && stage == NULL; i++)
+        if(strcmp(stats->stages[i].name, name) == 0)
+            stage = &stats->stages[i];
+    if(stage == NULL && stats->count < MAX_STAGES){
+        stage = &stats->stages[stats->count++];
+        stage->name = name;
+    }
+    if(stage != NULL){
+        stage->calls++;
+        stage->seconds += seconds;
+        stage->pixels += pixels;
+        for(j = 0; j < PERF_EVENTS; j++)
+            stage->events[j] += counts[j];
+        if(pool != NULL && pool->busy != NULL){
+            if(stage->busy == NULL && (stage->busy = (double*)calloc(pool->size, sizeof(double))) != NULL)
+                stage->workers = pool->size;
+            for(i = 0; i < stage->workers; i++)
+                stage->busy[i] += pool->busy[i];
+        }
+        if(pool != NULL && pool->events != NULL && stage->busy != NULL){
+            if(stage->worker_events == NULL)
+                stage->worker_events = (uint64_t*)calloc((size_t)stage->workers * PERF_EVENTS, sizeof(uint64_t));
+            for(i = 0; i < stage->workers; i++)
+                for(j = 0; j < PERF_EVENTS; j++){
+                    stage->events[j] += pool->events[i * PERF_EVENTS + j];
+                    if(stage->worker_events != NULL)
+                        stage->worker_events[i * PERF_EVENTS + j] += pool->events[i * PERF_EVENTS + j];
+                }
+        }
+    }
+    //the pool is idle between jobs, so its counters can be read and cleared here
+    if(pool != NULL && pool->busy != NULL)
+        memset(pool->busy, 0, pool->size * sizeof(double));
+    if(pool != NULL && pool->events != NULL)
+        memset(pool->events, 0, (size_t)pool->size * PERF_EVENTS * sizeof(uint64_t));
+    pthread_mutex_unlock(&stats->lock);
+}
+
+//shortest, mean and longest busy time of a stage's workers
+static void busy_range(const StageStats* stage, double* least, double* mean, double* most) {
+    int i;
+    *least = *most = stage->busy[0];
+    *mean = 0;
+    for(i = 0; i < stage->workers; i++){
+        *mean += stage->busy[i];
+        if(stage->busy[i] < *least)
+            *least = stage->busy[i];
+        if(stage->busy[i] > *most)
+            *most = stage->busy[i];
+    }
+    *mean /= stage->workers;
+}
+
+//instructions per cycle, negative when either event was not counted
+static double ipc(int events, const uint64_t* counts) {
+    if(!(events & 1 << PERF_CYCLES) || !(events & 1 << PERF_INSTRUCTIONS) || counts[PERF_CYCLES] == 0)
+        return -1;
+    return (double)counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES];
+}
+
+//misses of one event per pixel, negative when the event was not counted
+static double per_pixel(int events, const StageStats* stage, int event) {
+    if(!(events & 1 << event) || stage->pixels <= 0)
+        return -1;
+    return stage->events[event] / stage->pixels;
+}
+
+//a figure as JSON, null when it is not known
+static void print_figure(FILE* file, const char* name, double value) {
+    if(value < 0)
+        fprintf(file, ", \"%s\": null", name);
+    else fprintf(file, ", \"%s\": %.4g", name, value);
+}
+
+//the event counts and the figures worked out from them, as JSON members
+static void print_events(FILE* file, int events, const StageStats* stage) {
+    static const char* names[PERF_EVENTS] = {"cycles", "instructions", "llc_misses", "branch_misses"};
+    int i;
+    for(i = 0; i < PERF_EVENTS; i++)
+        if(events & 1 << i)
+            fprintf(file, ", \"%s\": %llu", names[i], (unsigned long long)stage->events[i]);
+        else fprintf(file, ", \"%s\": null", names[i]);
+    print_figure(file, "ipc", ipc(events, stage->events));
+    print_figure(file, "llc_misses_per_pixel", per_pixel(events, stage, PERF_LLC_MISSES));
+    print_figure(file, "branch_misses_per_pixel", per_pixel(events, stage, PERF_BRANCH_MISSES));
+    if(stage->worker_events != NULL){
+        fprintf(file, ", \"worker_ipc\": [");
+        for(i = 0; i < stage->workers; i++){
+            double figure = ipc(events, &stage->worker_events[i * PERF_EVENTS]);
+            if(figure < 0)
+                fprintf(file, "%snull", i > 0 ? ", " : "");
+            else fprintf(file, "%s%.3f", i > 0 ? ", " : "", figure);
+        }
+        fprintf(file, "]");
+    }
+}
+
+//the figures as table columns, - where one is not known
+static void print_event_columns(FILE* file, int events, const StageStats* stage) {
+    double figures[3];
+    int i;
+    figures[0] = ipc(events, stage->events);
+    figures[1] = per_pixel(events, stage, PERF_LLC_MISSES);
+    figures[2] = per_pixel(events, stage, PERF_BRANCH_MISSES);
+    for(i = 0; i < 3; i++)
+        if(figures[i] < 0)
+            fprintf(file, " %10s", "-");
+        else fprintf(file, " %10.4f", figures[i]);
+}
+
+void stats_print(RunStats* stats, FILE* file, double total, int json) {
+    int i, j;
+    double least = 0, mean = 0, most = 0;
+    char busy[64];
+    StageStats* stage;
+    pthread_mutex_lock(&stats->lock);
+    if(json)
+        fprintf(file, "{\"total_ms\": %.3f, \"stages\": [", total * 1e3);
+    else {
+        fprintf(file, "%-14s %6s %12s %8s %30s %10s", "stage", "calls", "wall ms", "workers", "busy ms min/mean/max", "imbalance");
+        if(stats->events != 0)
+            fprintf(file, " %10s %10s %10s", "ipc", "llc/px", "br miss/px");
+        fprintf(file, "\n");
+    }
+    for(i = 0; i < stats->count; i++){
+        stage = &stats->stages[i];
+        if(stage->workers > 0)
+            busy_range(stage, &least, &mean, &most);
+        if(json){
+            fprintf(file, "%s{\"name\": \"%s\", \"calls\": %d, \"wall_ms\": %.3f", i > 0 ? ", " : "", stage->name, stage->calls, stage->seconds * 1e3);
+            if(stage->workers > 0){
+                fprintf(file, ", \"worker_busy_ms\": [");
+                for(j = 0; j < stage->workers; j++)
+                    fprintf(file, "%s%.3f", j > 0 ? ", " : "", stage->busy[j] * 1e3);
+                fprintf(file, "], \"imbalance\": %.3f", mean > 0 ? most / mean : 1.0);
+            }
+            if(stats->events != 0)
+                print_events(file, stats->events, stage);
+            fprintf(file, "}");
+            continue;
+        }
+        if(stage->workers > 0){
+            snprintf(busy, sizeof(busy), "%.3f/%.3f/%.3f", least * 1e3, mean * 1e3, most * 1e3);
+            fprintf(file, "%-14s %6d %12.3f %8d %30s %10.2f", stage->name, stage->calls, stage->seconds * 1e3,
+                    stage->workers, busy, mean > 0 ? most / mean : 1.0);
+        }
+        else if(stats->events != 0)
+            fprintf(file, "%-14s %6d %12.3f %8s %30s %10s", stage->name, stage->calls, stage->seconds * 1e3, "", "", "");
+        else fprintf(file, "%-14s %6d %12.3f", stage->name, stage->calls, stage->seconds * 1e3);
+        if(stats->events != 0)
+            print_event_columns(file, stats->events, stage);
+        fprintf(file, "\n");
+    }
+    if(json)
+        fprintf(file, "]}\n");
+    else fprintf(file, "%-14s %6s %12.3f\n", "total", "", total * 1e3);
+    pthread_mutex_unlock(&stats->lock);
+}
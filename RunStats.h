@@ -0,0 +1,114 @@
+/**
+* Wall-clock timings of the stages of a run and of the time each pool worker
+* spent in tasks, optionally with hardware event counts, for finding out where
+* a slow run spends its time.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef RunStats_H
+#define RunStats_H 1
+#include <stdio.h>
+#include <pthread.h>
+#include "ThreadPool.h"
+#include "PerfCounters.h"
+#include "FilterExport.h"
+
+#define MAX_STAGES 16
+
+typedef struct StageStats {
+	const char* name;	//name of the stage, which must outlive the stats
+	int calls;		//number of times the stage ran
+	double seconds;		//wall time of all its runs
+	int workers;		//number of workers it kept busy, 0 if it ran on one thread
+	double* busy;		//seconds each worker spent in its tasks
+	double pixels;		//pixels of the images of all its runs
+	uint64_t events[PERF_EVENTS];	//hardware events on every thread of the stage
+	uint64_t* worker_events;	//PERF_EVENTS counts per worker of the events in its tasks
+}StageStats;
+
+typedef struct RunStats {
+	pthread_mutex_t lock;		//stages may finish on different threads
+	StageStats stages[MAX_STAGES];	//in the order they first finished
+	int count;			//number of stages
+	int events;			//a bit for each hardware event counted, 0 when only timing
+}RunStats;
+
+//one run of a stage being measured on the thread that runs it
+typedef struct StageTimer {
+	double start;			//monotonic clock when the stage began
+	PerfCounters counters;		//the thread's event counters, while events are counted
+}StageTimer;
+
+/**
+ * start collecting timings.
+ *
+ * @return The empty stats, or NULL if memory ran out
+ */
+GOODMAN_API RunStats* stats_create(void);
+
+
+/**
+ * release stats created by stats_create.
+ *
+ * @param  stats: The stats to free, may be NULL
+ */
+GOODMAN_API void stats_destroy(RunStats* stats);
+
+
+/**
+ * seconds on the monotonic clock, for measuring stages.
+ */
+GOODMAN_API double stats_now(void);
+
+
+/**
+ * count cycles, instructions, last level cache misses and branch misses of
+ * every stage from now on, on the threads that time stages and on the workers
+ * of pools passed to pool_count_events.
+ *
+ * @param  stats: The stats
+ * @return 0 if at least one event can be counted, -1 with errno set if the
+ *         kernel or the cpu allows none, in which case only time is measured
+ */
+GOODMAN_API int stats_count_events(RunStats* stats);
+
+
+/**
+ * begin one run of a stage on the calling thread. Does nothing if stats is NULL.
+ *
+ * @param  stats: The stats, may be NULL
+ * @param  timer: Where to keep the start of the stage until stats_end
+ */
+GOODMAN_API void stats_begin(RunStats* stats, StageTimer* timer);
+
+
+/**
+ * end one run of a stage, on the thread that began it, and add it to the
+ * stats. With a pool, the time and events of its workers' tasks since the last
+ * stage that passed the pool are added to the stage and the workers' counters
+ * start again from zero. Does nothing if stats is NULL.
+ *
+ * @param  stats: The stats, may be NULL
+ * @param  timer: The timer given to stats_begin
+ * @param  name: Name of the stage
+ * @param  pool: Pool the stage ran its tasks on, NULL if it used none
+ * @param  pixels: Pixels of the image the stage worked on, for the per-pixel figures
+ */
+GOODMAN_API void stats_end(RunStats* stats, StageTimer* timer, const char* name, ThreadPool* pool, double pixels);
+
+
+/**
+ * print every stage with its wall time and, for stages that used a pool, each
+ * worker's busy time and the load imbalance: the busiest worker's time over the
+ * mean, 1.00 meaning the work was spread evenly. When events were counted, the
+ * instructions per cycle and the cache and branch misses per pixel follow.
+ *
+ * @param  stats: The stats
+ * @param  file: Where to print
+ * @param  total: Wall time of the whole run in seconds
+ * @param  json: 1 to print one JSON object, 0 to print a table
+ */
+GOODMAN_API void stats_print(RunStats* stats, FILE* file, double total, int json);
+#endif
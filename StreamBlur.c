@@ -0,0 +1,125 @@
+/**
+* File:   StreamBlur.c
+* Streaming band-by-band box blur of BMP files.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include "StreamBlur.h"
+#include "ImageBuffer.h"
+#include "BoxBlur.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//MACRO DEFINITIONS
+//output rows finished per band, unless the radius asks for more
+#define STREAM_BAND_ROWS 64
+//pieces each worker's share of a band is cut into
+#define PIECES_PER_WORKER 2
+
+////////////////////////////////////////////////////////////////////////////////
+//DATA STRUCTURES
+//the band being blurred, split into count pieces of rows for the workers
+typedef struct StreamBand {
+    Image* window;
+    int window_top;
+    Image* output;
+    int height;
+    int radius;
+    int start;
+    int end;
+    int pieces;
+    atomic_int failed;  //set by a piece that ran out of memory
+}StreamBand;
+
+////////////////////////////////////////////////////////////////////////////////
+//FORWARD DECLARATIONS
+static void band_task(void* context, int task, int worker);
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+int stream_box_blur(FILE* input, FILE* output, int width, int height, int radius, ThreadPool* pool) {
+    int row_size = (width * 3 + 3) & ~3, band_rows, window_rows, count = 0, first, last, read, result = 0;
+    unsigned char *window_data, *output_data;
+    size_t got;
+    StreamBand band;
+    if(radius > (INT_MAX - STREAM_BAND_ROWS) / 2){
+        errno = EINVAL;
+        return -1;
+    }
+    //neither the band nor the window ever needs more scanlines than the image has
+    band_rows = STREAM_BAND_ROWS > 2 * radius ? STREAM_BAND_ROWS : 2 * radius;
+    window_rows = band_rows + 2 * radius < height ? band_rows + 2 * radius : height;
+    if(band_rows > height)
+        band_rows = height;
+    if(band_rows < 1)
+        band_rows = window_rows = 1;
+    //scanlines keep their file padding, so whole bands move with one read or write
+    window_data = (unsigned char*)malloc((size_t)window_rows * row_size);
+    output_data = (unsigned char*)calloc((size_t)band_rows, row_size);
+    band.window = image_wrap(window_data, width, window_rows, row_size, 1);
+    band.output = image_wrap(output_data, width, band_rows, row_size, 1);
+    if(window_data == NULL || output_data == NULL || band.window == NULL || band.output == NULL){
+        errno = ENOMEM;
+        result = -1;
+        goto done;
+    }
+    band.window_top = 0;
+    band.height = height;
+    band.radius = radius;
+    atomic_init(&band.failed, 0);
+    for(band.start = 0; band.start < height; band.start = band.end){
+        band.end = band.start + band_rows < height ? band.start + band_rows : height;
+        first = band.start - radius > 0 ? band.start - radius : 0;
+        last = band.end + radius < height ? band.end + radius : height;
+        //drop the scanlines no longer in reach and read the ones the band now needs
+        if(first > band.window_top){
+            memmove(window_data, window_data + (size_t)(first - band.window_top) * row_size, (size_t)(count - (first - band.window_top)) * row_size);
+            count -= first - band.window_top;
+            band.window_top = first;
+        }
+        read = last - band.window_top - count;
+        got = fread(window_data + (size_t)count * row_size, 1, (size_t)read * row_size, input);
+        //a truncated file leaves the missing scanlines black
+        if(got < (size_t)read * row_size)
+            memset(window_data + (size_t)count * row_size + got, 0, (size_t)read * row_size - got);
+        count += read;
+        band.pieces = pool->size * PIECES_PER_WORKER < band.end - band.start ? pool->size * PIECES_PER_WORKER : band.end - band.start;
+        if(pool_run(pool, band_task, &band, band.pieces) != 0 || atomic_load(&band.failed)){
+            errno = ENOMEM;
+            result = -1;
+            goto done;
+        }
+        if(fwrite(output_data, 1, (size_t)(band.end - band.start) * row_size, output) != (size_t)(band.end - band.start) * row_size){
+            errno = EIO;
+            result = -1;
+            goto done;
+        }
+    }
+    //the last bands may still sit in the stream's buffer
+    if(fflush(output) != 0){
+        errno = EIO;
+        result = -1;
+    }
+done:
+    image_destroy(band.window);
+    image_destroy(band.output);
+    free(window_data);
+    free(output_data);
+    return result;
+}
+
+static void band_task(void* context, int task, int worker) {
+    StreamBand* band = (StreamBand*)context;
+    int rows = band->end - band->start;
+    int start = band->start + (int)((long long)rows * task / band->pieces);
+    int end = band->start + (int)((long long)rows * (task + 1) / band->pieces);
+    if(box_blur_window(band->window, band->window_top, band->height, band->output, band->start, band->radius, start, end) != 0)
+        atomic_store(&band->failed, 1);
+}
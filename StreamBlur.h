@@ -0,0 +1,33 @@
+/**
+* Box blur of a BMP file streamed through a rolling window of scanlines, so
+* memory grows with the width of the image rather than its area.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef StreamBlur_H
+#define StreamBlur_H 1
+#include <stdio.h>
+#include "ThreadPool.h"
+
+/**
+ * blur the pixel array of a BMP file into another. Input scanlines are read a
+ * band at a time and dropped once every row they reach has been written, and
+ * each band of output is written as soon as it is finished. No more scanlines
+ * are held than the image has, whatever the radius. The blur is the same
+ * in either vertical direction and on any channel, so scanlines are processed in
+ * file order and left in file order and orientation.
+ *
+ * @param  input: Input file, positioned at the start of its pixel array
+ * @param  output: Output file, positioned where its pixel array starts
+ * @param  width: Width of the image in pixels
+ * @param  height: Number of scanlines in the image
+ * @param  radius: Number of neighbours on each side of a pixel
+ * @param  pool: Workers that blur the rows of each band
+ * @return 0 on success, -1 with errno set to ENOMEM if memory ran out, to EIO
+ *         if the output could not be written, or to EINVAL if the radius is too
+ *         large to count the rows it reaches
+ */
+int stream_box_blur(FILE* input, FILE* output, int width, int height, int radius, ThreadPool* pool);
+#endif
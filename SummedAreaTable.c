@@ -0,0 +1,159 @@
+/**
+* File:   SummedAreaTable.c
+* Construction of summed-area tables and constant-time box averages over them.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <string.h>
+#include "SummedAreaTable.h"
+#include "BoxBlur.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//FORWARD DECLARATIONS
+void sat_box_row(const SummedAreaTable* table, int radius, int y0, int y1, unsigned int* box);
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+SummedAreaTable* sat_create(int width, int height) {
+    SummedAreaTable* table = (SummedAreaTable*)malloc(sizeof(SummedAreaTable));
+    if(table == NULL)
+        return NULL;
+    table->width = width;
+    table->height = height;
+    table->stride = 3 * (width + 1);
+    table->sums = (unsigned int*)malloc((size_t)table->stride * (height + 1) * sizeof(unsigned int));
+    if(table->sums == NULL){
+        free(table);
+        return NULL;
+    }
+    //the zero row; the zero column is written by sat_scan_rows
+    memset(table->sums, 0, table->stride * sizeof(unsigned int));
+    return table;
+}
+
+void sat_destroy(SummedAreaTable* table) {
+    if(table == NULL)
+        return;
+    free(table->sums);
+    free(table);
+}
+
+void sat_scan_rows(SummedAreaTable* table, const Image* image, int start, int end) {
+    int x, y;
+    unsigned int red, green, blue, *sums;
+    const unsigned char* p;
+    for(y = start; y < end; y++){
+        p = (const unsigned char*)image_row(image, y);
+        sums = table->sums + (size_t)(y + 1) * table->stride;
+        red = green = blue = 0;
+        sums[0] = sums[1] = sums[2] = 0;
+        for(x = 0; x < table->width; x++){
+            red += p[3 * x];
+            green += p[3 * x + 1];
+            blue += p[3 * x + 2];
+            sums[3 * x + 3] = red;
+            sums[3 * x + 4] = green;
+            sums[3 * x + 5] = blue;
+        }
+    }
+}
+
+void sat_scan_columns(SummedAreaTable* table, int start, int end) {
+    int k, y, k0 = 3 * start + 3, k1 = 3 * end + 3;
+    unsigned int *above, *row;
+    //walk down the strip a row segment at a time so every access is sequential
+    for(y = 2; y <= table->height; y++){
+        above = table->sums + (size_t)(y - 1) * table->stride;
+        row = above + table->stride;
+        for(k = k0; k < k1; k++)
+            row[k] += above[k];
+    }
+}
+
+void sat_box_average(const SummedAreaTable* table, int x0, int y0, int x1, int y1, Pixel* average) {
+    const unsigned int *top, *bottom;
+    unsigned long long count, totals[3] = {0, 0, 0};
+    int k, strip_top, strip_bottom, strip_rows;
+    if(x0 < 0)
+        x0 = 0;
+    if(y0 < 0)
+        y0 = 0;
+    if(x1 > table->width)
+        x1 = table->width;
+    if(y1 > table->height)
+        y1 = table->height;
+    if(x0 >= x1 || y0 >= y1){
+        average->red = average->green = average->blue = 0;
+        return;
+    }
+    count = (unsigned long long)(x1 - x0) * (y1 - y0);
+    //each strip of rows holds few enough pixels for its 32-bit total to be exact
+    strip_rows = SAT_MAX_BOX / (x1 - x0);
+    for(strip_top = y0; strip_top < y1; strip_top = strip_bottom){
+        strip_bottom = y1 - strip_top > strip_rows ? strip_top + strip_rows : y1;
+        top = table->sums + (size_t)strip_top * table->stride;
+        bottom = table->sums + (size_t)strip_bottom * table->stride;
+        for(k = 0; k < 3; k++)
+            totals[k] += (unsigned int)(bottom[3 * x1 + k] - bottom[3 * x0 + k] - top[3 * x1 + k] + top[3 * x0 + k]);
+    }
+    average->red = (unsigned char)(totals[0] / count);
+    average->green = (unsigned char)(totals[1] / count);
+    average->blue = (unsigned char)(totals[2] / count);
+}
+
+int sat_blur_rows(const SummedAreaTable* table, Image* output, int radius, int start, int end) {
+    int y, k, y0, y1, strip_top, strip_bottom, strip_rows, box_columns, box_rows, width = table->width, height = table->height;
+    unsigned int* box = (unsigned int*)malloc(3 * (size_t)width * sizeof(unsigned int));
+    unsigned long long* wide_box = NULL;
+    //a box past both sides of the image covers all of it, and so does any larger one
+    if(radius > width && radius > height)
+        radius = width > height ? width : height;
+    //boxes of more than SAT_MAX_BOX pixels are totalled a strip of rows at a time in 64 bits
+    box_columns = radius < width / 2 ? 2 * radius + 1 : (width > 0 ? width : 1);
+    box_rows = radius < height / 2 ? 2 * radius + 1 : height;
+    strip_rows = SAT_MAX_BOX / box_columns;
+    if(box_rows > strip_rows)
+        wide_box = (unsigned long long*)malloc(3 * (size_t)width * sizeof(unsigned long long));
+    if(box == NULL || (box_rows > strip_rows && wide_box == NULL)){
+        free(box);
+        free(wide_box);
+        return -1;
+    }
+    for(y = start; y < end; y++){
+        y0 = y - radius > 0 ? y - radius : 0;
+        y1 = radius < height - y - 1 ? y + radius + 1 : height;
+        if(wide_box == NULL){
+            sat_box_row(table, radius, y0, y1, box);
+            box_average_row(box, image_row(output, y), width, radius, y1 - y0);
+            continue;
+        }
+        memset(wide_box, 0, 3 * (size_t)width * sizeof(unsigned long long));
+        for(strip_top = y0; strip_top < y1; strip_top = strip_bottom){
+            strip_bottom = y1 - strip_top > strip_rows ? strip_top + strip_rows : y1;
+            sat_box_row(table, radius, strip_top, strip_bottom, box);
+            for(k = 0; k < 3 * width; k++)
+                wide_box[k] += box[k];
+        }
+        box_average_row_wide(wide_box, image_row(output, y), width, radius, y1 - y0);
+    }
+    free(box);
+    free(wide_box);
+    return 0;
+}
+
+void sat_box_row(const SummedAreaTable* table, int radius, int y0, int y1, unsigned int* box) {
+    int x, k, x0, x1, width = table->width;
+    const unsigned int* top = table->sums + (size_t)y0 * table->stride;
+    const unsigned int* bottom = table->sums + (size_t)y1 * table->stride;
+    //four lookups give the totals of rows y0 to y1 - 1 of the clipped box around every pixel
+    for(x = 0; x < width; x++){
+        x0 = x - radius > 0 ? x - radius : 0;
+        x1 = radius < width - x - 1 ? x + radius + 1 : width;
+        for(k = 0; k < 3; k++)
+            box[3 * x + k] = bottom[3 * x1 + k] - bottom[3 * x0 + k] - top[3 * x1 + k] + top[3 * x0 + k];
+    }
+}
@@ -0,0 +1,98 @@
+/**
+* Summed-area table (integral image) over the three channels of an image, giving
+* the total of any rectangle in four lookups.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef SummedAreaTable_H
+#define SummedAreaTable_H 1
+#include <limits.h>
+#include "ImageBuffer.h"
+
+//most pixels a rectangle can hold for its total to be one exact difference of entries
+#define SAT_MAX_BOX (UINT_MAX / 255)
+
+//Entry (x, y) holds the channel totals of every pixel above and to the left of
+//pixel (x, y). Row 0 and column 0 are zero so that lookups need no bounds tests.
+//Totals are 32 bits and wrap on very large images, but a rectangle's total is a
+//difference of entries, so it stays exact as long as the rectangle itself holds
+//at most SAT_MAX_BOX pixels. Larger rectangles are totalled a strip of rows at a
+//time into 64 bits.
+typedef struct SummedAreaTable {
+	int width;			//width of the image in pixels
+	int height;			//height of the image in pixels
+	int stride;			//entries between rows, 3 * (width + 1)
+	unsigned int* sums;		//(height + 1) rows of red, green and blue totals
+}SummedAreaTable;
+
+/**
+ * allocate a table for an image of the given size. The table is filled in by
+ * sat_scan_rows over every row followed by sat_scan_columns over every column.
+ *
+ * @param  width: Width of the image in pixels
+ * @param  height: Height of the image in pixels
+ * @return The new table, or NULL if the allocation failed
+ */
+SummedAreaTable* sat_create(int width, int height);
+
+
+/**
+ * release a table created by sat_create.
+ *
+ * @param  table: The table to free, may be NULL
+ */
+void sat_destroy(SummedAreaTable* table);
+
+
+/**
+ * first pass of the build: prefix sums along each row of a band. Bands can be
+ * scanned concurrently.
+ *
+ * @param  table: The table being built
+ * @param  image: Image the table is built over
+ * @param  start: First row of the band
+ * @param  end: One past the last row of the band
+ */
+void sat_scan_rows(SummedAreaTable* table, const Image* image, int start, int end);
+
+
+/**
+ * second pass of the build: prefix sums down each column of a strip. Runs once
+ * every row has been scanned; strips can be scanned concurrently.
+ *
+ * @param  table: The table being built
+ * @param  start: First column of the strip
+ * @param  end: One past the last column of the strip
+ */
+void sat_scan_columns(SummedAreaTable* table, int start, int end);
+
+
+/**
+ * average of the pixels in a rectangle, clipped to the image.
+ *
+ * @param  table: A completed table
+ * @param  x0: Left column of the rectangle
+ * @param  y0: Top row of the rectangle
+ * @param  x1: One past the right column of the rectangle
+ * @param  y1: One past the bottom row of the rectangle
+ * @param  average: Destination for the average, black if nothing is left after clipping
+ */
+void sat_box_average(const SummedAreaTable* table, int x0, int y0, int x1, int y1, Pixel* average);
+
+
+/**
+ * blur a band of rows with a (2 * radius + 1) square box, averaging only the
+ * in-bounds neighbours exactly like box_blur_rows. Any number of radii can be
+ * rendered from one table, and bands can be blurred concurrently.
+ *
+ * @param  table: A completed table
+ * @param  output: Image to write, the same size as the table
+ * @param  radius: Number of neighbours on each side of a pixel, at least 1
+ * @param  start: First row of the band
+ * @param  end: One past the last row of the band
+ * @return 0 on success, -1 if scratch memory could not be allocated
+ */
+int sat_blur_rows(const SummedAreaTable* table, Image* output, int radius, int start, int end);
+#endif
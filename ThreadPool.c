@@ -0,0 +1,247 @@
+/**
+* File:   ThreadPool.c
+* Work-stealing thread pool shared by all filters.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <stdlib.h>
+#include <time.h>
+#include "ThreadPool.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//DATA STRUCTURES
+typedef struct Worker {
+    ThreadPool* pool;
+    int index;
+}Worker;
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+//owner's end: the most recently queued task, which is the most likely to be in cache
+static int take_task(TaskDeque* deque) {
+    int task = -1;
+    pthread_mutex_lock(&deque->lock);
+    if(deque->head < deque->tail)
+        task = deque->tasks[--deque->tail];
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+//thief's end: the task furthest from what the owner is working on
+static int steal_task(TaskDeque* deque) {
+    int task = -1;
+    pthread_mutex_lock(&deque->lock);
+    if(deque->head < deque->tail)
+        task = deque->tasks[deque->head++];
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+static double seconds_now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+//a task with its time and hardware events added to the worker's counters
+static void run_measured(ThreadPool* pool, int task, int index) {
+    int i;
+    double start;
+    uint64_t before[PERF_EVENTS], after[PERF_EVENTS];
+    if(pool->perf != NULL){
+        if(!pool->perf[index].ready)
+            perf_counters_open(&pool->perf[index]);
+        perf_counters_read(&pool->perf[index], before);
+    }
+    start = seconds_now();
+    pool->function(pool->context, task, index);
+    if(pool->busy != NULL)
+        pool->busy[index] += seconds_now() - start;
+    if(pool->perf != NULL){
+        perf_counters_read(&pool->perf[index], after);
+        for(i = 0; i < PERF_EVENTS; i++)
+            pool->events[index * PERF_EVENTS + i] += after[i] - before[i];
+    }
+}
+
+static void run_tasks(ThreadPool* pool, int index) {
+    int task, victim;
+    for(;;){
+        task = take_task(&pool->deques[index]);
+        for(victim = 1; task < 0 && victim < pool->size; victim++)
+            task = steal_task(&pool->deques[(index + victim) % pool->size]);
+        if(task < 0)
+            return;
+        //the job was published before its tasks were queued, and the deque lock orders the two
+        //each worker only adds to its own counters, which are read once the job is done
+        if(pool->busy != NULL || pool->perf != NULL)
+            run_measured(pool, task, index);
+        else pool->function(pool->context, task, index);
+        if(atomic_fetch_sub(&pool->remaining, 1) == 1){
+            pthread_mutex_lock(&pool->lock);
+            pthread_cond_broadcast(&pool->work_done);
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+}
+
+static void* worker_main(void* param) {
+    Worker* worker = (Worker*)param;
+    ThreadPool* pool = worker->pool;
+    int index = worker->index, seen = 0;
+    free(worker);
+    for(;;){
+        pthread_mutex_lock(&pool->lock);
+        while(!pool->shutdown && pool->generation == seen)
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        if(pool->shutdown){
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+        run_tasks(pool, index);
+    }
+}
+
+ThreadPool* pool_create(int size) {
+    int i;
+    Worker* worker;
+    ThreadPool* pool = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if(pool == NULL)
+        return NULL;
+    pool->threads = (pthread_t*)malloc(size * sizeof(pthread_t));
+    pool->deques = (TaskDeque*)calloc(size, sizeof(TaskDeque));
+    if(pool->threads == NULL || pool->deques == NULL){
+        free(pool->threads);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+    atomic_init(&pool->remaining, 0);
+    for(i = 0; i < size; i++)
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    for(i = 0; i < size; i++){
+        worker = (Worker*)malloc(sizeof(Worker));
+        if(worker == NULL)
+            break;
+        worker->pool = pool;
+        worker->index = i;
+        if(pthread_create(&pool->threads[i], NULL, worker_main, worker) != 0){
+            free(worker);
+            break;
+        }
+    }
+    pool->size = i;
+    if(pool->size == 0){
+        pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void pool_destroy(ThreadPool* pool) {
+    int i;
+    if(pool == NULL)
+        return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for(i = 0; i < pool->size; i++)
+        pthread_join(pool->threads[i], NULL);
+    for(i = 0; i < pool->size; i++){
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool->deques);
+    free(pool->busy);
+    pool_count_events(pool, 0);
+    free(pool);
+}
+
+int pool_time_workers(ThreadPool* pool, int on) {
+    if(!on){
+        free(pool->busy);
+        pool->busy = NULL;
+    }
+    else if(pool->busy == NULL && (pool->busy = (double*)calloc(pool->size, sizeof(double))) == NULL)
+        return -1;
+    return 0;
+}
+
+int pool_count_events(ThreadPool* pool, int on) {
+    int i;
+    if(!on){
+        for(i = 0; pool->perf != NULL && i < pool->size; i++)
+            perf_counters_close(&pool->perf[i]);
+        free(pool->perf);
+        free(pool->events);
+        pool->perf = NULL;
+        pool->events = NULL;
+    }
+    else if(pool->perf == NULL){
+        pool->perf = (PerfCounters*)calloc(pool->size, sizeof(PerfCounters));
+        pool->events = (uint64_t*)calloc((size_t)pool->size * PERF_EVENTS, sizeof(uint64_t));
+        if(pool->perf == NULL || pool->events == NULL){
+            pool_count_events(pool, 0);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int pool_run(ThreadPool* pool, TaskFunction function, void* context, int count) {
+    int i, task, start, end, *tasks;
+    TaskDeque* deque;
+    if(count <= 0)
+        return 0;
+    //make room in every deque before anything is queued, so a failure leaves no job behind
+    for(i = 0; i < pool->size; i++){
+        deque = &pool->deques[i];
+        end = (int)((long long)count * (i + 1) / pool->size) - (int)((long long)count * i / pool->size);
+        pthread_mutex_lock(&deque->lock);
+        if(deque->capacity < end){
+            tasks = (int*)realloc(deque->tasks, end * sizeof(int));
+            if(tasks == NULL){
+                pthread_mutex_unlock(&deque->lock);
+                return -1;
+            }
+            deque->tasks = tasks;
+            deque->capacity = end;
+        }
+        pthread_mutex_unlock(&deque->lock);
+    }
+    pool->function = function;
+    pool->context = context;
+    atomic_store(&pool->remaining, count);
+    //deal each worker a contiguous run of tasks, queued so the owner starts at the front
+    for(i = 0; i < pool->size; i++){
+        deque = &pool->deques[i];
+        start = (int)((long long)count * i / pool->size);
+        end = (int)((long long)count * (i + 1) / pool->size);
+        pthread_mutex_lock(&deque->lock);
+        deque->head = 0;
+        deque->tail = 0;
+        for(task = end - 1; task >= start; task--)
+            deque->tasks[deque->tail++] = task;
+        pthread_mutex_unlock(&deque->lock);
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    while(atomic_load(&pool->remaining) > 0)
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+* A persistent pool of worker threads that run numbered tasks, balancing the
+* load by work stealing.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef ThreadPool_H
+#define ThreadPool_H 1
+#include <pthread.h>
+#include <stdatomic.h>
+#include "PerfCounters.h"
+
+/**
+ * body of a task.
+ *
+ * @param  context: Pointer given to pool_run, shared by every task of the job
+ * @param  task: Task number, from 0 to the task count - 1
+ * @param  worker: Number of the worker running the task, from 0 to the pool size - 1
+ */
+typedef void (*TaskFunction)(void* context, int task, int worker);
+
+//Each worker owns a deque of task numbers. It pops from the tail of its own,
+//and when that runs dry it steals from the head of the others'.
+typedef struct TaskDeque {
+	pthread_mutex_t lock;
+	int* tasks;		//task numbers, head to tail - 1 still waiting
+	int capacity;		//length of tasks
+	int head;		//next task a thief takes
+	int tail;		//one past the next task the owner takes
+}TaskDeque;
+
+typedef struct ThreadPool {
+	int size;			//number of worker threads
+	pthread_t* threads;
+	TaskDeque* deques;		//one per worker
+	TaskFunction function;		//body of the current job's tasks
+	void* context;			//argument of the current job's tasks
+	atomic_int remaining;		//tasks of the current job not yet finished
+	pthread_mutex_t lock;		//guards generation, shutdown and the conditions
+	pthread_cond_t work_ready;	//signalled when a job is submitted
+	pthread_cond_t work_done;	//signalled when the last task of a job finishes
+	int generation;			//number of jobs submitted so far
+	int shutdown;			//set when the pool is being destroyed
+	double* busy;			//seconds each worker spent in tasks, kept while non-NULL
+	PerfCounters* perf;		//each worker's counters, opened on its own thread, while non-NULL
+	uint64_t* events;		//PERF_EVENTS counts per worker of the events in its tasks
+}ThreadPool;
+
+/**
+ * start a pool of worker threads, which sleep until a job is submitted.
+ *
+ * @param  size: Number of workers, at least 1
+ * @return The new pool, or NULL if it could not be created
+ */
+ThreadPool* pool_create(int size);
+
+
+/**
+ * stop the workers and release the pool.
+ *
+ * @param  pool: The pool to destroy, may be NULL
+ */
+void pool_destroy(ThreadPool* pool);
+
+
+/**
+ * start or stop counting the seconds each worker spends in tasks, in busy.
+ * Must not be called while a job runs.
+ *
+ * @param  pool: The pool
+ * @param  on: 1 to count, 0 to stop
+ * @return 0 on success, -1 if memory for the counters could not be allocated
+ */
+int pool_time_workers(ThreadPool* pool, int on);
+
+
+/**
+ * start or stop counting the hardware events of each worker's tasks, in events.
+ * Each worker opens its counters before its next task; a worker whose counters
+ * cannot be opened counts nothing. Must not be called while a job runs.
+ *
+ * @param  pool: The pool
+ * @param  on: 1 to count, 0 to stop
+ * @return 0 on success, -1 if memory for the counters could not be allocated
+ */
+int pool_count_events(ThreadPool* pool, int on);
+
+
+/**
+ * run tasks 0 to count - 1 on the pool and wait for all of them to finish.
+ * Workers start on contiguous runs of task numbers, so neighbouring tasks tend
+ * to run on the same worker, then steal from each other to even out the load.
+ * One job runs at a time.
+ *
+ * @param  pool: The pool
+ * @param  function: Body of every task
+ * @param  context: Argument passed to every task
+ * @param  count: Number of tasks
+ * @return 0 on success, -1 if memory for the task queues could not be allocated
+ */
+int pool_run(ThreadPool* pool, TaskFunction function, void* context, int count);
+#endif
@@ -0,0 +1,58 @@
+/**
+* File:   TileScheduler.c
+* Cache-sized 2D tiling of images for the filters.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+////////////////////////////////////////////////////////////////////////////////
+//INCLUDES
+#include <unistd.h>
+#include "TileScheduler.h"
+
+////////////////////////////////////////////////////////////////////////////////
+//MACRO DEFINITIONS
+//tiles are at least this many pixels on a side, so per-tile overhead stays small
+#define MIN_TILE_SIZE 16
+//and at most this wide, so that several tiles share the rows of wide images
+#define MAX_TILE_WIDTH 1024
+
+////////////////////////////////////////////////////////////////////////////////
+//IMPLEMENTATION
+long l2_cache_size(void) {
+    long size = -1;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    return size > 0 ? size : DEFAULT_L2_CACHE_SIZE;
+}
+
+void tile_grid_init(TileGrid* grid, int width, int height, int bytes_per_pixel, int halo) {
+    long budget = l2_cache_size() / 2 / bytes_per_pixel;
+    grid->width = width;
+    grid->height = height;
+    //keep tiles wide, since rows are what the hardware streams in
+    grid->tile_width = width < MAX_TILE_WIDTH ? width : MAX_TILE_WIDTH;
+    grid->tile_height = (int)(budget / (grid->tile_width + 2 * halo)) - 2 * halo;
+    if(grid->tile_height < MIN_TILE_SIZE)
+        grid->tile_height = MIN_TILE_SIZE;
+    if(grid->tile_height > height)
+        grid->tile_height = height;
+    if(grid->tile_width < 1)
+        grid->tile_width = 1;
+    if(grid->tile_height < 1)
+        grid->tile_height = 1;
+    grid->columns = (width + grid->tile_width - 1) / grid->tile_width;
+    grid->rows = (height + grid->tile_height - 1) / grid->tile_height;
+}
+
+int tile_grid_count(const TileGrid* grid) {
+    return grid->columns * grid->rows;
+}
+
+void tile_grid_tile(const TileGrid* grid, int index, Tile* tile) {
+    tile->x0 = index % grid->columns * grid->tile_width;
+    tile->y0 = index / grid->columns * grid->tile_height;
+    tile->x1 = tile->x0 + grid->tile_width < grid->width ? tile->x0 + grid->tile_width : grid->width;
+    tile->y1 = tile->y0 + grid->tile_height < grid->height ? tile->y0 + grid->tile_height : grid->height;
+}
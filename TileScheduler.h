@@ -0,0 +1,67 @@
+/**
+* Splits an image into cache-sized rectangular tiles for the filters to work on.
+*
+* @author Goodman
+* @version 2020.09.10
+*/
+
+#ifndef TileScheduler_H
+#define TileScheduler_H 1
+
+//used when the cpu does not report the size of its L2 cache
+#define DEFAULT_L2_CACHE_SIZE (256 * 1024)
+
+typedef struct Tile {
+	int x0;		//first column of the tile
+	int y0;		//first row of the tile
+	int x1;		//one past the last column of the tile
+	int y1;		//one past the last row of the tile
+}Tile;
+
+typedef struct TileGrid {
+	int width;		//width of the image in pixels
+	int height;		//height of the image in pixels
+	int tile_width;		//width of every tile but the last in each row
+	int tile_height;	//height of every tile but the last in each column
+	int columns;		//number of tiles across the image
+	int rows;		//number of tiles down the image
+}TileGrid;
+
+/**
+ * size of the cpu's L2 cache in bytes, DEFAULT_L2_CACHE_SIZE if unknown.
+ */
+long l2_cache_size(void);
+
+
+/**
+ * lay a grid of tiles over an image. Tiles are sized so that one tile of every
+ * image a filter touches, plus a halo of the given width around the input tile,
+ * fits in half of the L2 cache, leaving the rest to the other hyperthread and
+ * to the hardware prefetcher.
+ *
+ * @param  grid: The grid to set up
+ * @param  width: Width of the image in pixels
+ * @param  height: Height of the image in pixels
+ * @param  bytes_per_pixel: Bytes a filter reads and writes per pixel of the tile
+ * @param  halo: Number of extra pixels the filter reads around each side of a tile
+ */
+void tile_grid_init(TileGrid* grid, int width, int height, int bytes_per_pixel, int halo);
+
+
+/**
+ * number of tiles in a grid.
+ *
+ * @param  grid: The grid
+ */
+int tile_grid_count(const TileGrid* grid);
+
+
+/**
+ * bounds of a tile, clipped to the image.
+ *
+ * @param  grid: The grid
+ * @param  index: Tile number, in row-major order
+ * @param  tile: Destination for the bounds
+ */
+void tile_grid_tile(const TileGrid* grid, int index, Tile* tile);
+#endif